@@ -2,23 +2,3567 @@
 #define VIRGIL_LIB_HPP
 
 #include <string>
-#include <iomanip>
-#include <sstream>
 #include <stdexcept>
 #include <chrono>
 #include <variant>
 #include <optional>
 #include <cstdint>
+#include <array>
+#include <string_view>
+#include <charconv>
+#include <cmath>
+#include <climits>
+#include <cfloat>
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <thread>
+#include <functional>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <shared_mutex>
+#include <mutex>
+#include <unordered_map>
+#include <deque>
+#include <type_traits>
+#include <new>
+#include <initializer_list>
+#if defined(__cpp_impl_three_way_comparison) && __cpp_impl_three_way_comparison >= 201907L
+#include <compare>
+#endif
+
+// Define VIRGIL_NO_EXCEPTIONS to build without exceptions (e.g. with -fno-exceptions on AUX controllers).
+// Everything that would throw calls the VirgilErrorHandler instead, and nlohmann::json is built with
+// JSON_NOEXCEPTION so its own errors reach the same handler. Decode untrusted input with the Try*
+// functions, which return errors as values and never reach the handler.
+#ifdef VIRGIL_NO_EXCEPTIONS
+#ifndef JSON_NOEXCEPTION
+#define JSON_NOEXCEPTION
+#endif
+[[noreturn]] inline void VirgilJsonError(const char* message);
+#ifndef JSON_THROW_USER
+#define JSON_THROW_USER(exception) VirgilJsonError((exception).what())
+#endif
+#define VIRGIL_TRY if(true)
+#define VIRGIL_CATCH_ALL if(false)
+#define VIRGIL_RETHROW std::abort()
+#else
+#define VIRGIL_TRY try
+#define VIRGIL_CATCH_ALL catch(...)
+#define VIRGIL_RETHROW throw
+#endif
+
+// Define VIRGIL_STATIC_CAPACITY to store InfoResponse lists and linked device names inline, with the
+// fixed capacities below, instead of in std::vector and std::string. Override the limits before
+// including this header.
+#ifdef VIRGIL_STATIC_CAPACITY
+#ifndef VIRGIL_MAX_PARAMETERS
+#define VIRGIL_MAX_PARAMETERS 16 // Parameters per InfoResponse
+#endif
+#ifndef VIRGIL_MAX_LINKED_CHANNELS
+#define VIRGIL_MAX_LINKED_CHANNELS 8 // linkedChannels entries per InfoResponse
+#endif
+#ifndef VIRGIL_MAX_DEVICE_NAME
+#define VIRGIL_MAX_DEVICE_NAME 31 // Characters in a linkedChannels deviceName
+#endif
+#endif
+
+#include "nlohmann/json.hpp" // nlohmann/json single header
+#include <cstdint>
+
+// Forward declarations
+struct MessageID;
+struct ChannelID;
+class Message;
+struct MessageFactory;
+class ChannelLink;
+struct Parameter;
+struct LinkedChannelInfo;
+
+/**
+ * @brief Enumeration of every message type defined by the Virgil Protocol 2.3.0.
+ * 
+ * Messages carry their type on the wire as the "messageType" string. This enum is the
+ * library-internal form of that string, so dispatch and comparisons never have to touch
+ * the string itself. Use MessageTypeName() and ParseMessageType() to convert at the JSON boundary.
+ * 
+ * @note The numeric values are only used internally (as table indices) and are never sent over the wire
+ * @see Message::FromJSON for how inbound messages are dispatched by type
+ */
+enum class MessageType : uint8_t {
+    channelLink = 0,
+    channelUnlink = 1,
+    infoRequest = 2,
+    infoResponse = 3,
+    deviceInfoRequest = 4,
+    deviceInfoResponse = 5,
+    parameterCommand = 6,
+    statusUpdate = 7,
+    statusRequest = 8,
+    subscribeMessage = 9,
+    unsubscribeMessage = 10,
+    errorResponse = 11,
+    endResponse = 12
+};
+
+inline constexpr size_t MessageTypeCount = 13;
+
+// Wire names of every MessageType, indexed by the enum value.
+inline constexpr std::array<std::string_view, MessageTypeCount> MessageTypeNames = {
+    "channelLink",
+    "channelUnlink",
+    "infoRequest",
+    "infoResponse",
+    "deviceInfoRequest",
+    "deviceInfoResponse",
+    "parameterCommand",
+    "statusUpdate",
+    "statusRequest",
+    "subscribeMessage",
+    "unsubscribeMessage",
+    "errorResponse",
+    "endResponse"
+};
+
+// Gets the wire name ("messageType" value) of a MessageType.
+constexpr std::string_view MessageTypeName(MessageType type) {
+    return MessageTypeNames[static_cast<size_t>(type)];
+}
+
+// Checks whether messages of a type carry parameters as object-valued keys. Decoders skip the object-valued keys of every other type.
+constexpr bool CarriesParameters(MessageType type) {
+    return type == MessageType::infoResponse || type == MessageType::parameterCommand;
+}
+
+/// @brief Seeded 32-bit FNV-1a hash, usable at compile time.
+/// Used to build perfect hash tables over the fixed sets of strings defined by the protocol.
+/// @param str The string to hash.
+/// @param seed The starting hash value. Different seeds give different (independent) hash functions.
+constexpr uint32_t VirgilHash(std::string_view str, uint32_t seed = 0x811c9dc5u) {
+    uint32_t hash = seed;
+    for (char c : str) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief A compile-time perfect hash table over a fixed list of protocol strings.
+ * 
+ * Maps each string in `names` to its index with one VirgilHash and one string compare.
+ * The top SlotBits bits of the hash select a slot, so the seed must be chosen (searched offline)
+ * such that no two names share a slot. Every table should be checked with
+ * `static_assert(table.IsPerfect())` so that editing the name list without picking a new seed
+ * fails to compile instead of silently misclassifying strings.
+ * 
+ * @tparam N Number of names in the table (at most 255).
+ * @tparam SlotBits Number of hash bits used to pick a slot. The table has 2^SlotBits slots.
+ */
+template <size_t N, size_t SlotBits>
+struct PerfectHashTable {
+    static constexpr uint8_t EmptySlot = 0xFF;
+
+    std::array<std::string_view, N> names; // The strings in the table, in index order
+    uint32_t seed; // Seed passed to VirgilHash
+    std::array<uint8_t, (size_t(1) << SlotBits)> slots; // Slot -> index into names, or EmptySlot
+
+    constexpr PerfectHashTable(const std::array<std::string_view, N>& tableNames, uint32_t hashSeed)
+        : names(tableNames), seed(hashSeed), slots() {
+        for (auto& slot : slots)
+            slot = EmptySlot;
+        for (size_t i = 0; i < N; ++i)
+            slots[SlotOf(names[i])] = static_cast<uint8_t>(i);
+    }
+
+    // Gets the slot a string hashes to.
+    constexpr size_t SlotOf(std::string_view name) const {
+        return VirgilHash(name, seed) >> (32 - SlotBits);
+    }
+
+    // Checks that no two names were hashed into the same slot.
+    constexpr bool IsPerfect() const {
+        for (size_t i = 0; i < N; ++i)
+            if (slots[SlotOf(names[i])] != i)
+                return false;
+        return true;
+    }
+
+    /// @brief Looks up a string in the table.
+    /// @return The index of the string in `names`, or -1 if it is not in the table.
+    constexpr int Find(std::string_view name) const {
+        uint8_t index = slots[SlotOf(name)];
+        if (index == EmptySlot || names[index] != name)
+            return -1;
+        return index;
+    }
+};
+
+// Perfect hash over MessageTypeNames. The seed was searched offline.
+inline constexpr PerfectHashTable<MessageTypeCount, 4> MessageTypeTable(MessageTypeNames, 0x811ca27cu);
+static_assert(MessageTypeTable.IsPerfect(), "MessageTypeTable seed no longer gives a perfect hash. Search for a new seed after changing MessageTypeNames.");
+
+/// @brief Converts a "messageType" string to its MessageType with one hash and one string compare.
+/// @param name The messageType string as received on the wire.
+/// @return The matching MessageType, or std::nullopt if the name is not a Virgil 2.3.0 message type.
+constexpr std::optional<MessageType> ParseMessageType(std::string_view name) {
+    int index = MessageTypeTable.Find(name);
+    if (index < 0)
+        return std::nullopt;
+    return static_cast<MessageType>(index);
+}
+
+/**
+ * @brief Enumeration of every fixed JSON key used by Virgil Protocol 2.3.0 messages.
+ * 
+ * This covers the message-level fields, the fields of linkedChannels entries and the fields of
+ * parameter objects. Decoders classify keys with ParseVirgilKey() and then decide what the key means
+ * based on where it appears (for example "channelIndex" inside a linkedChannels entry).
+ * Keys that are not listed here (such as parameter names in an infoResponse) are not VirgilKeys.
+ * 
+ * @note Values are bit positions in MessageFields::present, so there can be at most 32 keys
+ */
+enum class VirgilKey : uint8_t {
+    messageType = 0,
+    messageID = 1,
+    responseID = 2,
+    channelIndex = 3,
+    channelType = 4,
+    sendingChannelIndex = 5,
+    sendingChannelType = 6,
+    errorValue = 7,
+    errorString = 8,
+    linkedChannels = 9,
+    deviceName = 10,
+    dataType = 11,
+    value = 12,
+    readOnly = 13,
+    unit = 14,
+    minValue = 15,
+    maxValue = 16,
+    precision = 17,
+    enumValues = 18
+};
+
+inline constexpr size_t VirgilKeyCount = 19;
+
+// JSON names of every VirgilKey, indexed by the enum value.
+inline constexpr std::array<std::string_view, VirgilKeyCount> VirgilKeyNames = {
+    "messageType",
+    "messageID",
+    "responseID",
+    "channelIndex",
+    "channelType",
+    "sendingChannelIndex",
+    "sendingChannelType",
+    "errorValue",
+    "errorString",
+    "linkedChannels",
+    "deviceName",
+    "dataType",
+    "value",
+    "readOnly",
+    "unit",
+    "minValue",
+    "maxValue",
+    "precision",
+    "enumValues"
+};
+
+// Gets the JSON name of a VirgilKey.
+constexpr std::string_view VirgilKeyName(VirgilKey key) {
+    return VirgilKeyNames[static_cast<size_t>(key)];
+}
+
+// Gets the bit of a VirgilKey in a presence bitmask.
+constexpr uint32_t VirgilKeyBit(VirgilKey key) {
+    return uint32_t(1) << static_cast<uint32_t>(key);
+}
+
+// Perfect hash over VirgilKeyNames. The seed was searched offline.
+inline constexpr PerfectHashTable<VirgilKeyCount, 5> VirgilKeyTable(VirgilKeyNames, 0x811c9ddfu);
+static_assert(VirgilKeyTable.IsPerfect(), "VirgilKeyTable seed no longer gives a perfect hash. Search for a new seed after changing VirgilKeyNames.");
+
+/// @brief Classifies a JSON key with one hash and one string compare.
+/// @param name The key as received on the wire.
+/// @return The matching VirgilKey, or std::nullopt if the key is not a fixed protocol key.
+constexpr std::optional<VirgilKey> ParseVirgilKey(std::string_view name) {
+    int index = VirgilKeyTable.Find(name);
+    if (index < 0)
+        return std::nullopt;
+    return static_cast<VirgilKey>(index);
+}
+
+/**
+ * @brief The data type of a Parameter, carried on the wire as its "dataType" string.
+ * 
+ * Use ParameterTypeName() and ParseParameterType() to convert at the JSON boundary.
+ * 
+ * @note The numeric values are only used internally and are never sent over the wire
+ */
+enum class ParameterType : uint8_t {
+    string = 0,      // "string"
+    boolean = 1,     // "bool"
+    enumeration = 2, // "enum"
+    integer = 3,     // "int"
+    floating = 4     // "float"
+};
+
+inline constexpr size_t ParameterTypeCount = 5;
+
+// Wire names of every ParameterType, indexed by the enum value.
+inline constexpr std::array<std::string_view, ParameterTypeCount> ParameterTypeNames = {
+    "string",
+    "bool",
+    "enum",
+    "int",
+    "float"
+};
+
+// Gets the wire name ("dataType" value) of a ParameterType.
+constexpr std::string_view ParameterTypeName(ParameterType type) {
+    return ParameterTypeNames[static_cast<size_t>(type)];
+}
+
+// Perfect hash over ParameterTypeNames. The seed was searched offline.
+inline constexpr PerfectHashTable<ParameterTypeCount, 3> ParameterTypeTable(ParameterTypeNames, 0x811c9dc7u);
+static_assert(ParameterTypeTable.IsPerfect(), "ParameterTypeTable seed no longer gives a perfect hash. Search for a new seed after changing ParameterTypeNames.");
+
+/// @brief Converts a "dataType" string to its ParameterType with one hash and one string compare.
+/// @param name The dataType string as received on the wire.
+/// @return The matching ParameterType, or std::nullopt if the name is not a Virgil 2.3.0 data type.
+constexpr std::optional<ParameterType> ParseParameterType(std::string_view name) {
+    int index = ParameterTypeTable.Find(name);
+    if (index < 0)
+        return std::nullopt;
+    return static_cast<ParameterType>(index);
+}
+
+/**
+ * @brief Why a Virgil message, envelope or stream could not be decoded.
+ * 
+ * The last two codes are not decode failures. They are only passed to the VirgilErrorHandler.
+ * 
+ * @see VirgilDecodeError for the details that come with each code
+ */
+enum class VirgilErrorCode : uint8_t {
+    malformedJSON,      // Input is not valid JSON, or a stream contains something other than JSON objects
+    tooLarge,           // Envelope exceeds the configured maximum size
+    tooManyEntries,     // linkedChannels or the parameters do not fit the capacity set by VIRGIL_STATIC_CAPACITY
+    notAnObject,        // A message, envelope or parameter is not a JSON object
+    entryNotAnObject,   // An entry of an array (messages, linkedChannels) is not a JSON object
+    missingField,       // A required field is absent
+    wrongType,          // A field has the wrong JSON type
+    outOfRange,         // A numeric field is out of range
+    unknownMessageType, // messageType is not a Virgil 2.3.0 message type
+    wrongMessageType,   // messageType does not match the class being constructed
+    notImplemented,     // messageType is part of Virgil 2.3.0 but not implemented by this library
+    unknownDataType,    // A parameter's dataType is not a Virgil 2.3.0 data type
+    invalidMessageID,   // messageID or responseID is not a 12 digit HHMMSSmmm### string
+    invalidValue,       // A field has a value that is not allowed, such as an enum value not in enumValues
+    invalidArgument,    // Not a decode failure: a function was called with arguments it does not accept
+    jsonError           // Not a decode failure: nlohmann::json reported an error. Only seen by the VirgilErrorHandler
+};
+
+/**
+ * @brief A compact description of a decode failure. Building one never allocates.
+ * 
+ * Decoders fill in the error code, the field, and short copies of the names and input involved.
+ * The human-readable message is only built when to_string() is called, so rejecting malformed
+ * traffic costs a few stores instead of string formatting.
+ * 
+ * The offending input is copied into a fixed buffer rather than pointed to, because the SAX
+ * decoder reuses its buffers and the input is usually gone by the time the error is read.
+ * Copies longer than Excerpt::Capacity are truncated.
+ */
+struct VirgilDecodeError {
+    /// @brief The first Capacity bytes of a string, stored inline.
+    struct Excerpt {
+        static constexpr size_t Capacity = 47;
+
+        char text[Capacity]; // Only the first size bytes are set
+        uint8_t size = 0;
+        bool truncated = false;
+
+        Excerpt() = default;
+
+        Excerpt(std::string_view str) : size(static_cast<uint8_t>(std::min(str.size(), Capacity))), truncated(str.size() > Capacity) {
+            if(size)
+                std::memcpy(text, str.data(), size);
+        }
+
+        Excerpt(const std::string& str) : Excerpt(std::string_view(str)) {}
+
+        // Formats a number, for errors about numeric values.
+        static Excerpt Number(int64_t value) {
+            Excerpt excerpt;
+            excerpt.size = static_cast<uint8_t>(std::to_chars(excerpt.text, excerpt.text + Capacity, value).ptr - excerpt.text);
+            return excerpt;
+        }
+
+        static Excerpt Number(double value) {
+            Excerpt excerpt;
+            int length = std::snprintf(excerpt.text, Capacity, "%g", value);
+            excerpt.size = static_cast<uint8_t>(std::min<size_t>(length > 0 ? length : 0, Capacity - 1));
+            return excerpt;
+        }
+
+        std::string_view view() const {
+            return std::string_view(text, size);
+        }
+
+        bool empty() const {
+            return size == 0;
+        }
+    };
+
+    VirgilErrorCode code = VirgilErrorCode::invalidValue;
+    std::optional<VirgilKey> field; // The field that failed, if it is a VirgilKey
+    const char* owner = nullptr; // What was being decoded, e.g. "ChannelLink" or "Enum parameter". Must be a string literal
+    const char* expected = ""; // What was expected, e.g. "an unsigned integer". Must be a string literal
+    const char* received = ""; // JSON type name of the value that was received. Must be a string literal
+    uint64_t number = 0; // Out of range value, array index, byte position (0 if unknown), size limit or capacity, depending on code
+
+    Excerpt name; // Name of the parameter involved, if any
+    Excerpt input; // The offending value, or the name of a missing field that is not a VirgilKey
+
+    VirgilDecodeError() = default;
+
+    VirgilDecodeError(VirgilErrorCode errorCode, const char* errorOwner, std::optional<VirgilKey> errorField = std::nullopt)
+        : code(errorCode), field(errorField), owner(errorOwner) {}
+
+    // A required field is absent.
+    static VirgilDecodeError MissingField(const char* owner, VirgilKey field, std::string_view name = {}) {
+        VirgilDecodeError error(VirgilErrorCode::missingField, owner, field);
+        error.name = name;
+        return error;
+    }
+
+    // A required field that is not a VirgilKey is absent.
+    static VirgilDecodeError MissingField(const char* owner, std::string_view fieldName) {
+        VirgilDecodeError error(VirgilErrorCode::missingField, owner);
+        error.input = fieldName;
+        return error;
+    }
+
+    // A field has the wrong JSON type. Pass a null owner for message-level fields.
+    static VirgilDecodeError WrongType(const char* owner, VirgilKey field, const char* expected, const char* received, std::string_view name = {}) {
+        VirgilDecodeError error(VirgilErrorCode::wrongType, owner, field);
+        error.expected = expected;
+        error.received = received;
+        error.name = name;
+        return error;
+    }
+
+    // A field that is not a VirgilKey has the wrong JSON type.
+    static VirgilDecodeError WrongType(const char* owner, std::string_view fieldName, const char* expected, const char* received) {
+        VirgilDecodeError error(VirgilErrorCode::wrongType, owner);
+        error.input = fieldName;
+        error.expected = expected;
+        error.received = received;
+        return error;
+    }
+
+    // The message, envelope or parameter `owner` is not an object.
+    static VirgilDecodeError NotAnObject(const char* owner, const char* received) {
+        VirgilDecodeError error(VirgilErrorCode::notAnObject, owner);
+        error.received = received;
+        return error;
+    }
+
+    // An entry of the array `owner` is not an object.
+    static VirgilDecodeError EntryNotAnObject(const char* owner, uint64_t index, const char* received) {
+        VirgilDecodeError error(VirgilErrorCode::entryNotAnObject, owner);
+        error.number = index;
+        error.received = received;
+        return error;
+    }
+
+    // The list `owner` is already at its static capacity.
+    static VirgilDecodeError TooManyEntries(const char* owner, uint64_t capacity) {
+        VirgilDecodeError error(VirgilErrorCode::tooManyEntries, owner);
+        error.number = capacity;
+        return error;
+    }
+
+    // A numeric field is out of range. `expected` describes the valid range.
+    static VirgilDecodeError OutOfRange(VirgilKey field, uint64_t value, const char* expected = "") {
+        VirgilDecodeError error(VirgilErrorCode::outOfRange, nullptr, field);
+        error.number = value;
+        error.expected = expected;
+        return error;
+    }
+
+    // A numeric parameter field does not fit its type. The value is kept as text, since it can be negative or fractional.
+    static VirgilDecodeError OutOfRange(const char* owner, VirgilKey field, const Excerpt& value, const char* expected, std::string_view name = {}) {
+        VirgilDecodeError error(VirgilErrorCode::outOfRange, owner, field);
+        error.input = value;
+        error.expected = expected;
+        error.name = name;
+        return error;
+    }
+
+    // messageType is not a Virgil 2.3.0 message type.
+    static VirgilDecodeError UnknownMessageType(std::string_view value) {
+        VirgilDecodeError error(VirgilErrorCode::unknownMessageType, nullptr, VirgilKey::messageType);
+        error.input = value;
+        return error;
+    }
+
+    // messageType is valid but this library cannot construct it.
+    static VirgilDecodeError NotImplemented(std::string_view value) {
+        VirgilDecodeError error(VirgilErrorCode::notImplemented, nullptr, VirgilKey::messageType);
+        error.input = value;
+        return error;
+    }
+
+    // A parameter's dataType is not a Virgil 2.3.0 data type.
+    static VirgilDecodeError UnknownDataType(std::string_view name, std::string_view dataType) {
+        VirgilDecodeError error(VirgilErrorCode::unknownDataType, "Parameter", VirgilKey::dataType);
+        error.name = name;
+        error.input = dataType;
+        return error;
+    }
+
+    // A field has a value that is not allowed. `expected` completes the sentence, e.g. "cannot be empty".
+    static VirgilDecodeError InvalidValue(const char* owner, std::optional<VirgilKey> field, std::string_view value, const char* expected, std::string_view name = {}) {
+        VirgilDecodeError error(VirgilErrorCode::invalidValue, owner, field);
+        error.input = value;
+        error.expected = expected;
+        error.name = name;
+        return error;
+    }
+
+    /// @brief Renders the human-readable message.
+    std::string to_string() const {
+        std::string subject = owner ? owner : "";
+        if(!name.empty())
+            subject += " '" + Quote(name) + "'";
+        std::string fieldName = field ? std::string(VirgilKeyName(*field)) : Quote(input);
+
+        switch(code) {
+            case VirgilErrorCode::malformedJSON:
+                return subject + " JSON is malformed" + (number ? " at byte " + std::to_string(number) : "") + 
+                    (input.empty() ? "" : " near '" + Quote(input) + "'");
+            case VirgilErrorCode::tooLarge:
+                return subject + " exceeds the maximum size of " + std::to_string(number) + " bytes";
+            case VirgilErrorCode::tooManyEntries:
+                return subject + " has more than " + std::to_string(number) + " entries, the configured capacity";
+            case VirgilErrorCode::notAnObject:
+                return subject + " JSON must be an object, but received type: " + received;
+            case VirgilErrorCode::entryNotAnObject:
+                return subject + "[" + std::to_string(number) + "] must be an object, but received type: " + received;
+            case VirgilErrorCode::missingField:
+                return subject + " JSON must contain '" + fieldName + "' field";
+            case VirgilErrorCode::wrongType:
+                return (owner ? subject + " field '" : "Field '") + fieldName + "' must be " + expected + ", but received type: " + received;
+            case VirgilErrorCode::outOfRange:
+                return (owner ? subject + " field '" : "Field '") + fieldName + "' value (" + 
+                    (field && !input.empty() ? Quote(input) : std::to_string(number)) + ") is out of range" + 
+                    (*expected ? std::string(". It must be ") + expected : "");
+            case VirgilErrorCode::unknownMessageType:
+                return "Unknown messageType value: '" + Quote(input) + "'. Supported types: 'channelLink', 'channelUnlink', " +
+                    "'infoRequest', 'infoResponse', 'errorResponse', 'endResponse'";
+            case VirgilErrorCode::wrongMessageType:
+                return subject + " JSON must have messageType='" + expected + "', but received messageType='" + Quote(input) + "'";
+            case VirgilErrorCode::notImplemented:
+                return "messageType '" + Quote(input) + "' is part of Virgil Protocol 2.3.0 but is not yet implemented";
+            case VirgilErrorCode::unknownDataType:
+                return subject + " has unknown dataType: '" + Quote(input) + "'. Supported types: 'string', 'bool', 'enum', 'int', 'float'";
+            case VirgilErrorCode::invalidMessageID:
+                return "MessageID string '" + Quote(input) + "' " + expected + ". Expected format: HHMMSSmmm###";
+            case VirgilErrorCode::invalidValue:
+                return subject + (field ? " field '" + fieldName + "'" : "") + (input.empty() ? "" : " value '" + Quote(input) + "'") + " " + expected;
+            case VirgilErrorCode::invalidArgument:
+            case VirgilErrorCode::jsonError:
+                break; // Reported with their own message, never as a VirgilDecodeError
+        }
+        return "Unknown Virgil decode error";
+    }
+
+private:
+    static std::string Quote(const Excerpt& excerpt) {
+        return std::string(excerpt.view()) + (excerpt.truncated ? "..." : "");
+    }
+};
+
+/**
+ * @brief The exception thrown when decoding fails.
+ * 
+ * Derives from std::invalid_argument, so existing handlers keep working. It carries the compact
+ * VirgilDecodeError and only renders what() the first time it is called.
+ * 
+ * @note what() caches the rendered message, so do not call it on one exception from several threads at once
+ */
+class VirgilDecodeException : public std::invalid_argument {
+public:
+    explicit VirgilDecodeException(const VirgilDecodeError& decodeError) : std::invalid_argument(""), error(decodeError) {}
+
+    // Gets the details of the failure.
+    const VirgilDecodeError& Error() const noexcept {
+        return error;
+    }
+
+    // Gets the error code.
+    VirgilErrorCode Code() const noexcept {
+        return error.code;
+    }
+
+    const char* what() const noexcept override {
+        if(message.empty()) {
+            VIRGIL_TRY {
+                message = error.to_string();
+            }
+            VIRGIL_CATCH_ALL {
+                return "Virgil decode error";
+            }
+        }
+        return message.c_str();
+    }
+
+private:
+    VirgilDecodeError error;
+    mutable std::string message; // Rendered by the first call to what()
+};
+
+/**
+ * @brief Receives the failures that would be thrown, in builds with VIRGIL_NO_EXCEPTIONS.
+ * 
+ * @param code The VirgilErrorCode of a decode failure, invalidArgument for a rejected argument,
+ *        or jsonError for an error raised inside nlohmann::json
+ * @param message The what() text the exception would have carried. Only valid during the call.
+ * @note The handler must not return: reset the device, log and halt, or longjmp out. If it returns, std::abort() is called.
+ * @see SetVirgilErrorHandler
+ */
+using VirgilErrorHandler = void (*)(VirgilErrorCode code, const char* message);
+
+// The installed VirgilErrorHandler, or nullptr to abort.
+inline std::atomic<VirgilErrorHandler> CurrentVirgilErrorHandler{nullptr};
+
+/// @brief Installs the handler that replaces throwing when VIRGIL_NO_EXCEPTIONS is defined.
+/// Builds with exceptions never call it. Pass nullptr to restore the default, std::abort().
+inline void SetVirgilErrorHandler(VirgilErrorHandler handler) {
+    CurrentVirgilErrorHandler.store(handler);
+}
+
+// Passes a failure to the installed handler. Aborts if there is none or it returns.
+[[noreturn]] inline void VirgilHandleError(VirgilErrorCode code, const char* message) {
+    if(VirgilErrorHandler handler = CurrentVirgilErrorHandler.load())
+        handler(code, message);
+    std::abort();
+}
+
+/// @brief Throws VirgilDecodeException, or hands the error to the VirgilErrorHandler when built with VIRGIL_NO_EXCEPTIONS.
+/// Every decode failure that is not returned as a value goes through here.
+[[noreturn]] inline void VirgilThrowDecodeError(const VirgilDecodeError& error) {
+#ifdef VIRGIL_NO_EXCEPTIONS
+    VirgilHandleError(error.code, error.to_string().c_str());
+#else
+    throw VirgilDecodeException(error);
+#endif
+}
+
+/// @brief Throws std::invalid_argument, or reports invalidArgument to the VirgilErrorHandler when built with VIRGIL_NO_EXCEPTIONS.
+[[noreturn]] inline void VirgilThrowInvalidArgument(const std::string& message) {
+#ifdef VIRGIL_NO_EXCEPTIONS
+    VirgilHandleError(VirgilErrorCode::invalidArgument, message.c_str());
+#else
+    throw std::invalid_argument(message);
+#endif
+}
+
+#ifdef VIRGIL_NO_EXCEPTIONS
+// Called by nlohmann::json in place of throwing (see JSON_THROW_USER above).
+inline void VirgilJsonError(const char* message) {
+    VirgilHandleError(VirgilErrorCode::jsonError, message);
+}
+#endif
+
+/**
+ * @brief The result of a Try* function: either a value, or the VirgilDecodeError that prevented it.
+ * 
+ * The Try* functions (MessageID::TryParse, Message::TryFromJSON, MessageDecoder::TryDecode, ...) report
+ * failures through this instead of throwing, so rejecting bad input costs a branch rather than an
+ * exception unwind. The throwing functions are thin wrappers around them.
+ * 
+ * @example
+ * ```cpp
+ * VirgilResult<MessagePtr> result = MessageDecoder::TryDecode(text, false);
+ * if(!result) {
+ *     log(result.Error().to_string());
+ *     return;
+ * }
+ * Handle(**result);
+ * ```
+ */
+template <class T>
+class VirgilResult {
+public:
+    VirgilResult(T value) : storage(std::in_place_index<0>, std::move(value)) {}
+    VirgilResult(const VirgilDecodeError& error) : storage(std::in_place_index<1>, error) {}
+
+    // Checks if the result holds a value.
+    bool HasValue() const noexcept {
+        return storage.index() == 0;
+    }
+
+    explicit operator bool() const noexcept {
+        return HasValue();
+    }
+
+    /// @brief Gets the value.
+    /// @throws VirgilDecodeException carrying Error() if there is no value
+    T& Value() & {
+        ThrowIfError();
+        return *std::get_if<0>(&storage);
+    }
+
+    const T& Value() const& {
+        ThrowIfError();
+        return *std::get_if<0>(&storage);
+    }
+
+    T&& Value() && {
+        ThrowIfError();
+        return std::move(*std::get_if<0>(&storage));
+    }
+
+    // Unchecked access to the value. Only valid if HasValue().
+    T& operator*() & { return *std::get_if<0>(&storage); }
+    const T& operator*() const& { return *std::get_if<0>(&storage); }
+    T&& operator*() && { return std::move(*std::get_if<0>(&storage)); }
+    T* operator->() { return std::get_if<0>(&storage); }
+    const T* operator->() const { return std::get_if<0>(&storage); }
+
+    // Gets the error. Only valid if !HasValue().
+    const VirgilDecodeError& Error() const {
+        return *std::get_if<1>(&storage);
+    }
+
+private:
+    std::variant<T, VirgilDecodeError> storage;
+
+    void ThrowIfError() const {
+        if(storage.index() != 0)
+            VirgilThrowDecodeError(*std::get_if<1>(&storage));
+    }
+};
+
+/**
+ * @brief A vector with a fixed capacity, stored inline. It never allocates.
+ * 
+ * This is the list type of InfoResponse and MessageFields when VIRGIL_STATIC_CAPACITY is defined.
+ * It provides the part of the std::vector interface that the library uses.
+ * 
+ * Adding an element to a full vector is an invalid argument. The decoders check ListIsFull()
+ * before adding, and report tooManyEntries instead.
+ * 
+ * @tparam T The element type
+ * @tparam N The capacity
+ */
+template <class T, size_t N>
+class StaticVector {
+    static_assert(N > 0, "StaticVector capacity must be at least 1");
+
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    StaticVector() = default;
+
+    StaticVector(const StaticVector& other) {
+        for (const T& item : other)
+            emplace_back(item);
+    }
+
+    StaticVector(StaticVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        for (T& item : other)
+            emplace_back(std::move(item));
+        other.clear();
+    }
+
+    template <class InputIt>
+    StaticVector(InputIt first, InputIt last) {
+        for (; first != last; ++first)
+            emplace_back(*first);
+    }
+
+    StaticVector(std::initializer_list<T> items) : StaticVector(items.begin(), items.end()) {}
+
+    ~StaticVector() {
+        clear();
+    }
+
+    StaticVector& operator=(const StaticVector& other) {
+        if(this != &other) {
+            clear();
+            for (const T& item : other)
+                emplace_back(item);
+        }
+        return *this;
+    }
+
+    StaticVector& operator=(StaticVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        if(this != &other) {
+            clear();
+            for (T& item : other)
+                emplace_back(std::move(item));
+            other.clear();
+        }
+        return *this;
+    }
+
+    static constexpr size_t capacity() {
+        return N;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    // The capacity is fixed, so this does nothing.
+    void reserve(size_t) {}
+
+    /// @brief Constructs an element at the end.
+    /// @throws std::invalid_argument if the vector is full
+    template <class... Args>
+    T& emplace_back(Args&&... args) {
+        if(count == N)
+            VirgilThrowInvalidArgument("StaticVector is full. Its capacity is " + std::to_string(N));
+        T* item = new (data() + count) T(std::forward<Args>(args)...);
+        ++count;
+        return *item;
+    }
+
+    void push_back(const T& item) {
+        emplace_back(item);
+    }
+
+    void push_back(T&& item) {
+        emplace_back(std::move(item));
+    }
+
+    void pop_back() {
+        data()[--count].~T();
+    }
+
+    void clear() {
+        while(count)
+            pop_back();
+    }
+
+    T* data() { return reinterpret_cast<T*>(storage); }
+    const T* data() const { return reinterpret_cast<const T*>(storage); }
+    T& operator[](size_t index) { return data()[index]; }
+    const T& operator[](size_t index) const { return data()[index]; }
+    T& back() { return data()[count - 1]; }
+    const T& back() const { return data()[count - 1]; }
+    T* begin() { return data(); }
+    T* end() { return data() + count; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + count; }
+
+private:
+    alignas(T) unsigned char storage[N * sizeof(T)];
+    size_t count = 0;
+};
+
+/**
+ * @brief A string of at most N characters, stored inline. It never allocates.
+ * 
+ * This is the type of LinkedChannelInfo::deviceName when VIRGIL_STATIC_CAPACITY is defined.
+ * It converts to std::string_view, and is always null-terminated.
+ * 
+ * @tparam N The maximum length, not counting the terminator
+ */
+template <size_t N>
+class FixedString {
+public:
+    FixedString() = default;
+
+    /// @throws std::invalid_argument if str is longer than N
+    explicit FixedString(std::string_view str) {
+        assign(str);
+    }
+
+    /// @throws std::invalid_argument if str is longer than N
+    FixedString& operator=(std::string_view str) {
+        assign(str);
+        return *this;
+    }
+
+    /// @brief Replaces the contents.
+    /// @throws std::invalid_argument if str is longer than N
+    void assign(std::string_view str) {
+        if(str.size() > N)
+            VirgilThrowInvalidArgument("FixedString can hold " + std::to_string(N) + " characters, but received " + std::to_string(str.size()));
+        if(!str.empty())
+            std::memcpy(text, str.data(), str.size());
+        length = str.size();
+        text[length] = '\0';
+    }
+
+    static constexpr size_t capacity() {
+        return N;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    bool empty() const {
+        return length == 0;
+    }
+
+    void clear() {
+        length = 0;
+        text[0] = '\0';
+    }
+
+    const char* c_str() const {
+        return text;
+    }
+
+    operator std::string_view() const {
+        return std::string_view(text, length);
+    }
+
+    friend bool operator==(const FixedString& lhs, const FixedString& rhs) { return std::string_view(lhs) == std::string_view(rhs); }
+    friend bool operator==(const FixedString& lhs, std::string_view rhs) { return std::string_view(lhs) == rhs; }
+    friend bool operator==(std::string_view lhs, const FixedString& rhs) { return lhs == std::string_view(rhs); }
+    friend bool operator!=(const FixedString& lhs, const FixedString& rhs) { return !(lhs == rhs); }
+    friend bool operator!=(const FixedString& lhs, std::string_view rhs) { return !(lhs == rhs); }
+    friend bool operator!=(std::string_view lhs, const FixedString& rhs) { return !(lhs == rhs); }
+
+private:
+    char text[N + 1] = {};
+    size_t length = 0;
+};
+
+// The list and string types of InfoResponse, MessageFields and LinkedChannelInfo. See VIRGIL_STATIC_CAPACITY.
+#ifdef VIRGIL_STATIC_CAPACITY
+using ParameterList = StaticVector<Parameter, VIRGIL_MAX_PARAMETERS>;
+using LinkedChannelList = StaticVector<LinkedChannelInfo, VIRGIL_MAX_LINKED_CHANNELS>;
+using DeviceName = FixedString<VIRGIL_MAX_DEVICE_NAME>;
+#else
+using ParameterList = std::vector<Parameter>;
+using LinkedChannelList = std::vector<LinkedChannelInfo>;
+using DeviceName = std::string;
+#endif
+
+// Checks if a list cannot take another entry. A std::vector never fills up.
+template <class T>
+constexpr bool ListIsFull(const std::vector<T>&) {
+    return false;
+}
+
+template <class T, size_t N>
+constexpr bool ListIsFull(const StaticVector<T, N>& list) {
+    return list.size() == N;
+}
+
+// Checks if a device name fits in DeviceName.
+constexpr bool DeviceNameFits([[maybe_unused]] std::string_view name) {
+#ifdef VIRGIL_STATIC_CAPACITY
+    return name.size() <= VIRGIL_MAX_DEVICE_NAME;
+#else
+    return true;
+#endif
+}
+
+/**
+ * @brief The parameter names defined by Virgil Protocol 2.3.0.
+ * 
+ * These are pre-registered in every ParameterName table, with their enum value as their symbol.
+ * 
+ * @see Parameter for what each parameter means
+ */
+enum class KnownParameter : uint8_t {
+    gain = 0,
+    pad = 1,
+    padLevel = 2,
+    lowcut = 3,
+    lowcutEnable = 4,
+    polarity = 5,
+    phantomPower = 6,
+    rfEnable = 7,
+    transmitPower = 8,
+    squelch = 9,
+    deviceConnected = 10,
+    subDevice = 11,
+    audioLevel = 12,
+    rfLevel = 13,
+    batteryLevel = 14
+};
+
+inline constexpr size_t KnownParameterCount = 15;
+
+// Wire names of every KnownParameter, indexed by the enum value.
+inline constexpr std::array<std::string_view, KnownParameterCount> KnownParameterNames = {
+    "gain",
+    "pad",
+    "padLevel",
+    "lowcut",
+    "lowcutEnable",
+    "polarity",
+    "phantomPower",
+    "rfEnable",
+    "transmitPower",
+    "squelch",
+    "deviceConnected",
+    "subDevice",
+    "audioLevel",
+    "rfLevel",
+    "batteryLevel"
+};
+
+// Perfect hash over KnownParameterNames. The seed was searched offline.
+inline constexpr PerfectHashTable<KnownParameterCount, 5> KnownParameterTable(KnownParameterNames, 0x811c9dd0u);
+static_assert(KnownParameterTable.IsPerfect(), "KnownParameterTable seed no longer gives a perfect hash. Search for a new seed after changing KnownParameterNames.");
+
+/**
+ * @brief An interned parameter name: a small integer symbol standing for the name string.
+ * 
+ * Every distinct name is stored once in a process-wide table, so a device with 64 channels of
+ * "gain" parameters holds one "gain" string instead of 64, and comparing two names is an integer compare.
+ * 
+ * - The KnownParameter names are pre-registered: they use their enum value as their symbol and
+ *   are resolved with one perfect hash, without taking a lock
+ * - Any other name is added to the table the first time it is constructed. Lookups take a shared lock;
+ *   only adding a new name takes the exclusive lock
+ * - Names received from peers are made with Decoded(), which never adds to the table. A name that is
+ *   not already interned keeps its own reference-counted copy of the string instead, and is freed
+ *   with the last Parameter that uses it
+ * 
+ * Symbols are only meaningful within one process. Interned names are never removed, so the constructors
+ * are meant for the names the application itself uses, and decoders use Decoded().
+ * 
+ * @note Thread-safe
+ */
+class ParameterName {
+public:
+    /// @brief Constructs the empty name.
+    ParameterName() = default;
+
+    /// @brief Constructs a well-known name. Never touches the table.
+    ParameterName(KnownParameter known) : symbol(static_cast<uint32_t>(known)) {}
+
+    /// @brief Interns a name, adding it to the table if it is new.
+    ParameterName(std::string_view name) : symbol(Intern(name)) {}
+    ParameterName(const std::string& name) : ParameterName(std::string_view(name)) {}
+    ParameterName(const char* name) : ParameterName(std::string_view(name)) {}
+
+    /// @brief Looks up a name without adding it to the table.
+    /// @return The interned name, or std::nullopt if the name has never been interned
+    static std::optional<ParameterName> Find(std::string_view name) {
+        if(name.empty())
+            return ParameterName();
+        int known = KnownParameterTable.Find(name);
+        if(known >= 0)
+            return ParameterName(static_cast<KnownParameter>(known));
+        Registry& registry = GetRegistry();
+        std::shared_lock<std::shared_mutex> lock(registry.mutex);
+        auto it = registry.symbols.find(name);
+        if(it == registry.symbols.end())
+            return std::nullopt;
+        return FromSymbol(it->second);
+    }
+
+    /**
+     * @brief Makes a name received from a peer, without growing the table.
+     * 
+     * Interned names (including every KnownParameter) resolve to their symbol as usual. Any other
+     * name owns a copy of the string, so a peer that sends a stream of made-up names cannot make the
+     * table grow without bound.
+     */
+    static ParameterName Decoded(std::string_view name) {
+        std::optional<ParameterName> found = Find(name);
+        if(found)
+            return *found;
+        ParameterName local;
+        local.symbol = LocalSymbol;
+        local.owned = std::make_shared<const std::string>(name);
+        return local;
+    }
+
+    /// @brief Gets the name as a string. The view stays valid for the lifetime of the program,
+    /// or for names from Decoded() that were not interned, for as long as a copy of this name exists.
+    std::string_view to_string_view() const {
+        if(symbol == EmptySymbol)
+            return std::string_view();
+        if(symbol == LocalSymbol)
+            return *owned;
+        if(symbol < KnownParameterCount)
+            return KnownParameterNames[symbol];
+        Registry& registry = GetRegistry();
+        std::shared_lock<std::shared_mutex> lock(registry.mutex);
+        return registry.names[symbol - KnownParameterCount];
+    }
+
+    std::string to_string() const {
+        return std::string(to_string_view());
+    }
+
+    /// @brief Gets the well-known parameter this name stands for, if it is one.
+    std::optional<KnownParameter> Known() const {
+        if(symbol < KnownParameterCount)
+            return static_cast<KnownParameter>(symbol);
+        return std::nullopt;
+    }
+
+    /// @brief Gets the symbol. Equal interned names always have equal symbols. Names from Decoded()
+    /// that were not interned all share one symbol, so compare names with == rather than by symbol.
+    uint32_t Symbol() const {
+        return symbol;
+    }
+
+    /// @brief Checks whether the name is interned (or empty), rather than owning its own string.
+    bool IsInterned() const {
+        return symbol != LocalSymbol;
+    }
+
+    bool empty() const {
+        return symbol == EmptySymbol;
+    }
+
+    /// @brief Hashes the name, consistently with ==. Well-known names hash to their symbol without reading the string.
+    size_t Hash() const {
+        if(symbol < KnownParameterCount || symbol == EmptySymbol)
+            return symbol;
+        return VirgilHash(to_string_view());
+    }
+
+    // An interned name and a name from Decoded() can be equal, so those are compared by string.
+    bool operator==(const ParameterName& other) const {
+        if(symbol != LocalSymbol && other.symbol != LocalSymbol)
+            return symbol == other.symbol;
+        return to_string_view() == other.to_string_view();
+    }
+    bool operator!=(const ParameterName& other) const { return !(*this == other); }
+    // Orders the well-known names first, by symbol, then every other name alphabetically.
+    bool operator<(const ParameterName& other) const {
+        bool known = symbol < KnownParameterCount, otherKnown = other.symbol < KnownParameterCount;
+        if(known || otherKnown)
+            return known && otherKnown ? symbol < other.symbol : known;
+        if(symbol == other.symbol && symbol != LocalSymbol)
+            return false;
+        return to_string_view() < other.to_string_view();
+    }
+
+private:
+    static constexpr uint32_t EmptySymbol = ~uint32_t(0);
+    static constexpr uint32_t LocalSymbol = ~uint32_t(0) - 1; // Symbol of names from Decoded() that were not interned
+
+    uint32_t symbol = EmptySymbol;
+    std::shared_ptr<const std::string> owned; // The string, for names from Decoded() that were not interned
+
+    // Names other than the KnownParameters. The symbol of names[i] is KnownParameterCount + i.
+    struct Registry {
+        std::shared_mutex mutex;
+        std::deque<std::string> names; // A deque so existing strings never move when names are added
+        std::unordered_map<std::string_view, uint32_t> symbols; // Views into names
+    };
+
+    static Registry& GetRegistry() {
+        static Registry registry;
+        return registry;
+    }
+
+    static ParameterName FromSymbol(uint32_t value) {
+        ParameterName name;
+        name.symbol = value;
+        return name;
+    }
+
+    static uint32_t Intern(std::string_view name) {
+        std::optional<ParameterName> found = Find(name);
+        if(found)
+            return found->symbol;
+        Registry& registry = GetRegistry();
+        std::unique_lock<std::shared_mutex> lock(registry.mutex);
+        // Another thread may have added it between the lookup and taking the lock
+        auto it = registry.symbols.find(name);
+        if(it != registry.symbols.end())
+            return it->second;
+        uint32_t value = static_cast<uint32_t>(KnownParameterCount + registry.names.size());
+        registry.names.emplace_back(name);
+        registry.symbols.emplace(registry.names.back(), value);
+        return value;
+    }
+};
+
+namespace std {
+    template <>
+    struct hash<ParameterName> {
+        size_t operator()(const ParameterName& name) const noexcept {
+            return name.Hash();
+        }
+    };
+}
+
+
+/**
+ * @brief Appends compact JSON text to a caller-owned, reusable byte buffer.
+ * 
+ * JsonWriter is the allocation-free counterpart of building a nlohmann::json object and
+ * calling dump(). It writes straight into a std::string owned by the caller, so a sender
+ * can keep one buffer per connection, clear it between messages, and stop allocating once
+ * the buffer has grown to the size of its largest message.
+ * 
+ * Commas are inserted automatically. Inside an object, call Key() before every value.
+ * 
+ * @example
+ * ```cpp
+ * std::string buffer; // Owned by the caller and reused for every message
+ * JsonWriter writer(buffer);
+ * for (const Message* msg : outbox) {
+ *     writer.Clear();
+ *     msg->serialize(writer);
+ *     socket.send(buffer.data(), buffer.size());
+ * }
+ * ```
+ * 
+ * @note The writer does not check that the calls form valid JSON (for example, matching Begin/End calls)
+ */
+class JsonWriter {
+public:
+    /// @brief Creates a writer that appends to an existing buffer.
+    /// @param buffer The buffer to append to. It must outlive the writer. Existing contents are kept.
+    explicit JsonWriter(std::string& buffer) : out(buffer) {}
+
+    // Gets the buffer being written to.
+    std::string& Buffer() const {
+        return out;
+    }
+
+    // Empties the buffer, keeping its capacity, so it can be reused for the next message.
+    void Clear() {
+        out.clear();
+        needComma = false;
+    }
+
+    void BeginObject() {
+        Separate();
+        out.push_back('{');
+        needComma = false;
+    }
+
+    void EndObject() {
+        out.push_back('}');
+        needComma = true;
+    }
+
+    void BeginArray() {
+        Separate();
+        out.push_back('[');
+        needComma = false;
+    }
+
+    void EndArray() {
+        out.push_back(']');
+        needComma = true;
+    }
+
+    // Writes an object key. The next call must write its value.
+    void Key(std::string_view key) {
+        Separate();
+        AppendQuoted(key);
+        out.push_back(':');
+        needComma = false;
+    }
+
+    void String(std::string_view value) {
+        Separate();
+        AppendQuoted(value);
+        needComma = true;
+    }
+
+    // Writes a fixed-length string such as MessageID::to_array().
+    template <size_t N>
+    void String(const std::array<char, N>& value) {
+        String(std::string_view(value.data(), N));
+    }
+
+    void Int(int64_t value) {
+        Separate();
+        char digits[24];
+        char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        out.append(digits, end);
+        needComma = true;
+    }
+
+    void Unsigned(uint64_t value) {
+        Separate();
+        char digits[24];
+        char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        out.append(digits, end);
+        needComma = true;
+    }
+
+    /// @brief Writes a number using the shortest text that reads back as the same float.
+    /// Whole numbers are written with a trailing ".0" so they are still read back as floats.
+    /// Non-finite values are written as null, matching nlohmann::json.
+    void Float(float value) {
+        Separate();
+        needComma = true;
+        if(!std::isfinite(value)) {
+            out.append("null");
+            return;
+        }
+        char digits[32];
+        char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        out.append(digits, end);
+        if(std::find_if(digits, end, [](char c) { return c == '.' || c == 'e'; }) == end)
+            out.append(".0");
+    }
+
+    void Bool(bool value) {
+        Separate();
+        out.append(value ? "true" : "false");
+        needComma = true;
+    }
+
+    void Null() {
+        Separate();
+        out.append("null");
+        needComma = true;
+    }
+
+private:
+    std::string& out;
+    bool needComma = false; // True if the next key or value must be preceded by a comma
+
+    void Separate() {
+        if(needComma)
+            out.push_back(',');
+    }
+
+    // Appends a JSON string literal, escaping quotes, backslashes and control characters.
+    void AppendQuoted(std::string_view value) {
+        static constexpr char hexDigits[] = "0123456789abcdef";
+        out.push_back('"');
+        size_t runStart = 0;
+        for (size_t i = 0; i < value.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(value[i]);
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+            // Copy the run of characters that did not need escaping in one go
+            out.append(value.data() + runStart, i - runStart);
+            runStart = i + 1;
+            out.push_back('\\');
+            switch (c) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '\b': out.push_back('b'); break;
+                case '\f': out.push_back('f'); break;
+                case '\n': out.push_back('n'); break;
+                case '\r': out.push_back('r'); break;
+                case '\t': out.push_back('t'); break;
+                default:
+                    out.append("u00");
+                    out.push_back(hexDigits[c >> 4]);
+                    out.push_back(hexDigits[c & 0xF]);
+                    break;
+            }
+        }
+        out.append(value.data() + runStart, value.size() - runStart);
+        out.push_back('"');
+    }
+};
+
+/**
+ * @brief Enumeration representing the three types of channels in the Virgil Protocol 2.3.0.
+ * 
+ * The Virgil protocol defines three distinct channel types that correspond to different
+ * audio routing and device control scenarios:
+ * 
+ * - TX channels (0): Dante transmitting channels that send audio data
+ * - RX channels (1): Dante receiving channels that receive audio data  
+ * - AUX channels (2): Auxiliary non-Dante channels for accessory control
+ * 
+ * Channel linking rules:
+ * - TX channels can only link to RX channels and vice versa
+ * - AUX channels link to devices rather than other channels
+ * - Every Dante channel must have a corresponding Virgil channel
+ * 
+ * For example, a device with 12 Dante transmitting channels and 8 Dante receiving
+ * channels would advertise 12 TX channels and 8 RX channels in Virgil.
+ * 
+ * @see Virgil Protocol 2.3.0 - "Channel Types" section
+ * @note Channel indices start at 0 for all types
+ */
+enum class LinkType : uint8_t {
+    tx = 0,   ///< Transmit channels - Dante transmitting channels that send audio data
+    rx = 1,   ///< Receive channels - Dante receiving channels that receive audio data  
+    aux = 2   ///< Auxiliary channels - Non-Dante accessory channels (e.g., in-wall dials)
+};
+
+// Currently Unused, being implimented
+enum class VirgilError : uint8_t {
+    UnrecognizedCommand = 0,
+    ValueOutOfRange = 1,
+    InvalidValueType = 2,
+    UnableToChangeValue = 3,
+    DeviceNotFound = 4,
+    ChannelIndexInvalid = 5,
+    ParameterReadOnly = 6,
+    ParameterUnsupported = 7,
+    MalformedMessage = 8,
+    Busy = 9,
+    Timeout = 10,
+    PermissionDenied = 11,
+    InternalError = 12,
+    OutOfResources = 13,
+    NetworkError = 14,
+    Custom = 255
+};
+
+/**
+ * @brief A MessageID packed into one 64-bit integer, for use as a key in hash maps and sorted arrays.
+ * 
+ * Holds exactly what the HHMMSSmmm### string holds: milliseconds since local midnight in the upper
+ * bits and the message index in the low IndexBits bits. Comparing the packed values therefore
+ * orders IDs by time and then by index, and equal IDs always pack to the same value.
+ * 
+ * Convert with MessageID::Pack() and MessageID(PackedMessageID), or parse a received ID string
+ * directly with MessageID::ParsePacked().
+ * 
+ * @note Like the string form, the packed form does not say which day the ID is from
+ * @see MessageID for the full representation
+ */
+struct PackedMessageID {
+    static constexpr unsigned IndexBits = 10; ///< Bits used by the message index (0-999)
+
+    uint64_t value = 0; ///< (milliseconds since midnight << IndexBits) | message index
+
+    constexpr PackedMessageID() = default;
+
+    constexpr explicit PackedMessageID(uint64_t packedValue) : value(packedValue) {}
+
+    constexpr PackedMessageID(uint32_t msSinceMidnight, uint16_t index)
+        : value((static_cast<uint64_t>(msSinceMidnight) << IndexBits) | index) {}
+
+    // Gets the milliseconds since local midnight (the HHMMSSmmm part).
+    constexpr uint32_t MillisecondsSinceMidnight() const {
+        return static_cast<uint32_t>(value >> IndexBits);
+    }
+
+    // Gets the message index (the ### part).
+    constexpr uint16_t Index() const {
+        return static_cast<uint16_t>(value & ((uint64_t(1) << IndexBits) - 1));
+    }
+
+    constexpr bool operator==(const PackedMessageID& other) const { return value == other.value; }
+    constexpr bool operator!=(const PackedMessageID& other) const { return value != other.value; }
+    constexpr bool operator<(const PackedMessageID& other) const { return value < other.value; }
+    constexpr bool operator<=(const PackedMessageID& other) const { return value <= other.value; }
+    constexpr bool operator>(const PackedMessageID& other) const { return value > other.value; }
+    constexpr bool operator>=(const PackedMessageID& other) const { return value >= other.value; }
+#if defined(__cpp_impl_three_way_comparison) && __cpp_impl_three_way_comparison >= 201907L
+    constexpr std::strong_ordering operator<=>(const PackedMessageID& other) const { return value <=> other.value; }
+#endif
+};
+
+// Hashes PackedMessageID for unordered containers. The bits are mixed (splitmix64 finalizer) because
+// IDs are sequential, which would cluster badly in tables that use the low bits of the hash directly.
+namespace std {
+    template <>
+    struct hash<PackedMessageID> {
+        size_t operator()(const PackedMessageID& id) const noexcept {
+            uint64_t x = id.value;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            return static_cast<size_t>(x ^ (x >> 31));
+        }
+    };
+}
+
+/**
+ * @brief A struct representing a unique message identifier for Virgil Protocol 2.3.0 messages.
+ * 
+ * MessageID provides unique identification for every message in the Virgil protocol, enabling
+ * proper request-response correlation, logging, and debugging. The ID combines timestamp 
+ * information with a sequence counter to ensure uniqueness even under high message rates.
+ * 
+ * **Format**: 12-digit string "HHMMSSmmm###"
+ * - **HH**: Hour in 24-hour format (00-23)
+ * - **MM**: Minute (00-59)
+ * - **SS**: Second (00-59)  
+ * - **mmm**: Millisecond (000-999)
+ * - **###**: Message index within the same millisecond (000-999)
+ * 
+ * **Example**: "143052847000" = 14:30:52.847 (2:30:52.847 PM), message #0 in that millisecond
+ * 
+ * **Usage Patterns**:
+ * - Every message must have a unique messageID
+ * - Response messages include responseID referencing the original request's messageID
+ * - endResponse messages should NOT include responseID when ending sessions
+ * - statusUpdate messages include responseID only when responding to specific requests
+ * 
+ * **Implementation Notes**:
+ * - Timestamps use local device time (devices may not be synchronized)
+ * - Not recommended for precise timing - use only for logging and correlation
+ * - Auto-generation ensures uniqueness within a single device
+ * - Particularly important for AUX devices not connected via Dante
+ * 
+ * **Thread Safety**: 
+ * - GenerateNew() is lock-free and may be called from any number of threads without producing duplicate IDs,
+ *   unless the system clock is stepped backwards (see GenerateNew())
+ * - Threads that generate many IDs can call SetThreadShard() to generate from a private slice of the
+ *   index space instead, which avoids contending on the shared generator state entirely
+ * 
+ * @see Virgil Protocol 2.3.0 - "Message ID" section for complete specification
+ * @note Do not use for anything beyond logging - device timestamps may not be synchronized
+ */
+struct MessageID {
+    /**
+     * @brief Generates a new, unique MessageID for the current time.
+     * 
+     * The generator state (millisecond timestamp and index of the last ID) is packed into one
+     * atomic 64-bit word and advanced with a compare-and-swap loop, so concurrent callers never
+     * receive the same ID and never block each other. If the clock has not advanced (or has
+     * stepped backwards) since the last ID, the index within the last millisecond is incremented.
+     * 
+     * Only 1000 IDs (indices 000-999) exist per millisecond. When a burst uses them all up, the
+     * generator borrows the next millisecond and carries on, so IDs are never malformed. Borrowing
+     * is bounded: once the generator is MaxBorrowedMilliseconds ahead of the clock, callers
+     * yield until the clock catches up. Sustained rates above one million IDs per second are
+     * therefore throttled rather than pushed further into the future.
+     * 
+     * A clock that goes back by more than MaxBorrowedMilliseconds (for example an NTP step or a manual
+     * time change) is treated as a clock step rather than waited out: the generator restarts from the
+     * new time. IDs generated after such a step can therefore repeat IDs generated before it.
+     * 
+     * If the calling thread has called SetThreadShard(), the ID is generated from that thread's
+     * slice of the index space without touching shared state.
+     * 
+     * @return A MessageID that is unique within this process.
+     */
+    static MessageID GenerateNew() {
+        if (CurrentThreadShard().count != 0)
+            return GenerateSharded();
+
+        int64_t nowMs = NowMilliseconds();
+        uint64_t last = lastGenerated.load(std::memory_order_relaxed);
+        for (;;) {
+            int64_t lastMs = static_cast<int64_t>(last >> GeneratorIndexBits);
+            uint64_t next;
+            if (nowMs > lastMs || lastMs - nowMs > MaxBorrowedMilliseconds)
+                next = static_cast<uint64_t>(nowMs) << GeneratorIndexBits; // Clock advanced, or stepped back further than we ever borrow
+            else if ((last & GeneratorIndexMask) < MaxMessageIndex)
+                next = last + 1; // Next index in the same millisecond
+            else if (lastMs + 1 - nowMs <= MaxBorrowedMilliseconds)
+                next = static_cast<uint64_t>(lastMs + 1) << GeneratorIndexBits; // Millisecond used up: borrow the next one
+            else {
+                // Too far ahead of the clock: wait for it to catch up
+                std::this_thread::yield();
+                nowMs = NowMilliseconds();
+                last = lastGenerated.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (lastGenerated.compare_exchange_weak(last, next, std::memory_order_relaxed))
+                return FromGeneratorState(next);
+        }
+    }
+
+    /**
+     * @brief Makes GenerateNew() on the calling thread use a private slice of the index space.
+     * 
+     * The 1000 indices available in each millisecond are split into `shardCount` equal slices, and this
+     * thread only uses slice `shard`. The thread then generates IDs from thread-local state with no atomic
+     * operations. When its slice of a millisecond is used up, it borrows the next millisecond, with the
+     * same MaxBorrowedMilliseconds bound and clock-step handling as the shared generator.
+     * 
+     * @param shard The slice this thread uses, from 0 to shardCount - 1. Every thread must use a different shard.
+     * @param shardCount The number of slices. Must be the same on every sharded thread, between 1 and 1000.
+     * @throws std::invalid_argument if shard or shardCount are out of range
+     * @note Either every thread that generates IDs is sharded, or none are. Sharded and unsharded threads
+     *       draw from the same index space and can produce duplicate IDs if mixed.
+     */
+    static void SetThreadShard(uint16_t shard, uint16_t shardCount) {
+        if (shardCount == 0 || shardCount > 1000)
+            VirgilThrowInvalidArgument("MessageID shardCount (" + std::to_string(shardCount) + ") must be between 1 and 1000");
+        if (shard >= shardCount)
+            VirgilThrowInvalidArgument("MessageID shard (" + std::to_string(shard) + ") must be less than shardCount (" + 
+                std::to_string(shardCount) + ")");
+        ThreadShard& state = CurrentThreadShard();
+        state = ThreadShard{};
+        state.count = shardCount;
+        state.first = static_cast<uint16_t>(shard * (1000 / shardCount));
+        state.end = static_cast<uint16_t>(state.first + 1000 / shardCount);
+    }
+
+    // Makes GenerateNew() on the calling thread use the shared generator again.
+    static void ClearThreadShard() {
+        CurrentThreadShard() = ThreadShard{};
+    }
+
+    static constexpr uint16_t MaxMessageIndex = 999; ///< Largest index that fits in the ### part of the ID
+    static constexpr int64_t MaxBorrowedMilliseconds = 50; ///< How far ahead of the clock GenerateNew() may run during bursts
+
+    // Time the message was sent (system_clock::time_point)
+    std::chrono::system_clock::time_point timeSent{}; ///< Absolute timestamp when message was created
+    // Index of the message within the same millisecond (0-999).
+    uint16_t messageIndex = 0; ///< Sequence number for messages sent in the same millisecond
+
+    // Default constructor
+    MessageID() = default; 
+ 
+    /// @brief Constructor from format provided in virgil messages
+    /// 
+    /// Decodes the digits in place, eight at a time with SWAR (SIMD within a register) arithmetic,
+    /// so parsing does not allocate. Only the error path builds strings.
+    /// @param id A 12-digit string in the format HHMMSSmmm### where HH is hours, MM is minutes, SS is seconds, mmm is milliseconds, and ### is the message index.
+    /// @throws VirgilDecodeException if id is not exactly 12 ASCII digits, or HH, MM or SS is out of range
+    MessageID(std::string_view id) {
+        uint32_t msSinceMidnight = 0;
+        VirgilDecodeError error;
+        if(!DecodeDigits(id, msSinceMidnight, messageIndex, error))
+            VirgilThrowDecodeError(error);
+
+        // Convert relative time (since midnight) to absolute time_point
+        // The Virgil protocol uses time since midnight of the current day
+        timeSent = LocalMidnight(std::chrono::system_clock::now()) + std::chrono::milliseconds(msSinceMidnight);
+    }
+
+    // Constructor from a std::string. See MessageID(std::string_view).
+    MessageID(const std::string& id) : MessageID(std::string_view(id)) {}
+
+    // Constructor from a null-terminated string. See MessageID(std::string_view).
+    MessageID(const char* id) : MessageID(std::string_view(id)) {}
+
+    /// @brief Constructor from the packed form. The ID is placed in the current local day, like the string constructor.
+    explicit MessageID(PackedMessageID packed) {
+        messageIndex = packed.Index();
+        timeSent = LocalMidnight(std::chrono::system_clock::now()) + std::chrono::milliseconds(packed.MillisecondsSinceMidnight());
+    }
+
+    /// @brief Converts to the packed 64-bit form, which keeps only what the HHMMSSmmm### string holds.
+    /// Uses the cached midnight anchor, so this is integer arithmetic for IDs from the current day.
+    PackedMessageID Pack() const {
+        uint32_t msSinceMidnight = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(timeSent - LocalMidnight(timeSent)).count());
+        return PackedMessageID(msSinceMidnight, messageIndex);
+    }
+
+    /// @brief Parses the HHMMSSmmm### form straight into the packed form.
+    /// Unlike the string constructor this never looks at the clock or the time zone, so it is the
+    /// cheapest way to turn a received ID into a lookup key.
+    /// @throws VirgilDecodeException if id is not exactly 12 ASCII digits, or HH, MM or SS is out of range
+    static PackedMessageID ParsePacked(std::string_view id) {
+        return TryParsePacked(id).Value();
+    }
+
+    /// @brief Same as the string constructor, but reports a malformed id instead of throwing.
+    static VirgilResult<MessageID> TryParse(std::string_view id) {
+        VirgilResult<PackedMessageID> packed = TryParsePacked(id);
+        if(!packed)
+            return packed.Error();
+        return MessageID(*packed);
+    }
+
+    /// @brief Same as ParsePacked(), but reports a malformed id instead of throwing.
+    static VirgilResult<PackedMessageID> TryParsePacked(std::string_view id) {
+        uint32_t msSinceMidnight = 0;
+        uint16_t index = 0;
+        VirgilDecodeError error;
+        if(!DecodeDigits(id, msSinceMidnight, index, error))
+            return error;
+        return PackedMessageID(msSinceMidnight, index);
+    }
+
+    static constexpr size_t StringLength = 12; ///< Length of the HHMMSSmmm### form
+
+    /// @brief Writes the HHMMSSmmm### form into a caller-supplied buffer.
+    /// Formats with a two-digit lookup table; does not allocate and does not null-terminate.
+    /// @param out Receives exactly 12 digits.
+    /// @throws std::invalid_argument if messageIndex does not fit in 3 digits
+    void to_chars(char (&out)[StringLength]) const {
+        WriteDigits(out);
+    }
+
+    /// @brief Gets the HHMMSSmmm### form as a fixed-size array. Does not allocate.
+    /// @throws std::invalid_argument if messageIndex does not fit in 3 digits
+    std::array<char, StringLength> to_array() const {
+        std::array<char, StringLength> out;
+        WriteDigits(out.data());
+        return out;
+    }
+
+    /// @brief Appends the HHMMSSmmm### form to a buffer. Intended for serializers that reuse their buffer.
+    /// @throws std::invalid_argument if messageIndex does not fit in 3 digits
+    void append_to(std::string& out) const {
+        char digits[StringLength];
+        WriteDigits(digits);
+        out.append(digits, StringLength);
+    }
+
+    /// Convert to string to be used in virgil messages
+    /// @return HHMMSSmmm### format
+    /// @throws std::invalid_argument if messageIndex does not fit in 3 digits
+    std::string to_string() const {
+        char digits[StringLength];
+        WriteDigits(digits);
+        return std::string(digits, StringLength);
+    }
+
+    bool operator==(const MessageID& other) const {
+        return timeSent == other.timeSent && messageIndex == other.messageIndex;
+    }
+    bool operator!=(const MessageID& other) const {
+        return !(*this == other);
+    }
+
+    operator bool() const {
+    // Consider it valid if timeSent is not epoch or messageIndex is not zero
+    return timeSent != std::chrono::system_clock::time_point{} || messageIndex != 0;
+    }
+
+    /**
+     * @brief Finds local midnight at the start of the day containing a time point.
+     * 
+     * The local day that contains the current time is cached process-wide as a single atomic word,
+     * so for any time point in that day this is pure integer arithmetic: no localtime/mktime calls
+     * and no time zone lock. The cache is recomputed automatically the first time a time point
+     * after the cached day is seen (the day rolls over).
+     * 
+     * @param time Any time point.
+     * @return The time point of 00:00:00.000 local time on the same local day as `time`.
+     * @note Thread-safe. Call RefreshTimeAnchor() if the process time zone changes.
+     */
+    static std::chrono::system_clock::time_point LocalMidnight(std::chrono::system_clock::time_point time) {
+        using namespace std::chrono;
+        int64_t second = duration_cast<seconds>(time.time_since_epoch()).count();
+        if (time < system_clock::time_point(seconds(second)))
+            --second; // Round toward negative infinity
+        uint64_t anchor = midnightAnchor.load(std::memory_order_acquire);
+        int64_t dayStart = static_cast<int64_t>(anchor >> AnchorLengthBits);
+        int64_t dayLength = static_cast<int64_t>(anchor & ((uint64_t(1) << AnchorLengthBits) - 1));
+        if (second >= dayStart && second < dayStart + dayLength)
+            return system_clock::time_point(seconds(dayStart));
+
+        // Not in the cached day: ask the C library
+        int64_t start = 0;
+        int64_t length = 0;
+        ComputeLocalDay(second, start, length);
+        // Only cache the current day, so formatting an old ID does not evict it
+        int64_t now = duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+        if (now >= start && now < start + length)
+            StoreTimeAnchor(start, length);
+        return system_clock::time_point(seconds(start));
+    }
+
+    /// @brief Recomputes the cached local day used by LocalMidnight().
+    /// Call this after changing the process time zone (for example after setting TZ and calling tzset()).
+    /// Day rollovers are detected automatically and do not need this.
+    static void RefreshTimeAnchor() {
+        using namespace std::chrono;
+        int64_t now = duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+        int64_t start = 0;
+        int64_t length = 0;
+        ComputeLocalDay(now, start, length);
+        StoreTimeAnchor(start, length);
+    }
+
+private:
+    // State of the shared generator: (ms since epoch of the last ID << GeneratorIndexBits) | index of the last ID
+    inline static std::atomic<uint64_t> lastGenerated{0};
+    static constexpr unsigned GeneratorIndexBits = 10;
+    static constexpr uint64_t GeneratorIndexMask = (uint64_t(1) << GeneratorIndexBits) - 1;
+
+    // Per-thread generator state used after SetThreadShard().
+    struct ThreadShard {
+        uint16_t count = 0; // Number of shards, or 0 if this thread is not sharded
+        uint16_t first = 0; // First index of this thread's slice
+        uint16_t end = 0; // One past the last index of this thread's slice
+        uint16_t next = 0; // Next index to hand out in lastMs
+        int64_t lastMs = -1; // Millisecond of the last ID generated by this thread
+    };
+
+    // Gets the calling thread's sharding state.
+    static ThreadShard& CurrentThreadShard() {
+        thread_local ThreadShard shard;
+        return shard;
+    }
+
+    static int64_t NowMilliseconds() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Builds the MessageID described by a packed generator state.
+    static MessageID FromGeneratorState(uint64_t state) {
+        MessageID newId;
+        newId.timeSent = std::chrono::system_clock::time_point(std::chrono::milliseconds(static_cast<int64_t>(state >> GeneratorIndexBits)));
+        newId.messageIndex = static_cast<uint16_t>(state & GeneratorIndexMask);
+        return newId;
+    }
+
+    static MessageID GenerateSharded() {
+        ThreadShard& shard = CurrentThreadShard();
+        int64_t nowMs = NowMilliseconds();
+        if (nowMs > shard.lastMs || shard.lastMs - nowMs > MaxBorrowedMilliseconds) {
+            // Clock advanced, or stepped back further than we ever borrow
+            shard.lastMs = nowMs;
+            shard.next = shard.first;
+        }
+        else if (shard.next == shard.end) {
+            // Slice used up: borrow the next millisecond rather than spilling into another thread's slice
+            while (shard.lastMs + 1 - nowMs > MaxBorrowedMilliseconds) {
+                std::this_thread::yield();
+                nowMs = NowMilliseconds();
+            }
+            shard.lastMs = std::max(shard.lastMs + 1, nowMs);
+            shard.next = shard.first;
+        }
+        return FromGeneratorState((static_cast<uint64_t>(shard.lastMs) << GeneratorIndexBits) | shard.next++);
+    }
+
+    // Cached local day for LocalMidnight(): (midnight in seconds since epoch << AnchorLengthBits) | day length in seconds.
+    // 0 means nothing is cached (it is an empty range).
+    inline static std::atomic<uint64_t> midnightAnchor{0};
+    static constexpr unsigned AnchorLengthBits = 17; // Enough for 25 hour days
+
+    // Finds the start and length (in seconds since epoch) of the local day containing `second`.
+    static void ComputeLocalDay(int64_t second, int64_t& start, int64_t& length) {
+        std::time_t time = static_cast<std::time_t>(second);
+        std::tm local{};
+#if defined(_WIN32)
+        localtime_s(&local, &time);
+#else
+        localtime_r(&time, &local);
+#endif
+        local.tm_hour = 0;
+        local.tm_min = 0;
+        local.tm_sec = 0;
+        local.tm_isdst = -1; // Let mktime work out whether DST applied at midnight
+        std::tm next = local;
+        start = static_cast<int64_t>(std::mktime(&local));
+        next.tm_mday += 1; // mktime normalizes this into the next month/year if needed
+        length = static_cast<int64_t>(std::mktime(&next)) - start;
+    }
+
+    // Publishes a local day to the cache, if it can be represented.
+    static void StoreTimeAnchor(int64_t start, int64_t length) {
+        if (start < 0 || length <= 0 || length >= (int64_t(1) << AnchorLengthBits) || start >= (int64_t(1) << (64 - AnchorLengthBits)))
+            return;
+        midnightAnchor.store((static_cast<uint64_t>(start) << AnchorLengthBits) | static_cast<uint64_t>(length), std::memory_order_release);
+    }
+
+    // Decodes HHMMSSmmm### into milliseconds since midnight and the message index.
+    // Returns false and fills error if id is malformed.
+    static bool DecodeDigits(std::string_view id, uint32_t& msSinceMidnight, uint16_t& index, VirgilDecodeError& error) {
+        if (id.length() != 12) {
+            error = VirgilDecodeError(VirgilErrorCode::invalidMessageID, "MessageID");
+            error.input = id;
+            error.expected = "must be exactly 12 digits";
+            return false;
+        }
+
+        // First 8 characters (HHMMSSmm) as one 64-bit word, last 4 (m###) as one 32-bit word. Character 0 is the lowest byte.
+        uint64_t high = LoadLittleEndian<uint64_t>(id.data());
+        uint32_t low = LoadLittleEndian<uint32_t>(id.data() + 8);
+
+        // Validate that all characters are digits
+        if (!AllDigits(high) || !AllDigits(low)) {
+            error = VirgilDecodeError(VirgilErrorCode::invalidMessageID, "MessageID");
+            error.input = id;
+            error.expected = "must contain only digits 0-9";
+            return false;
+        }
+
+        // Combine each pair of adjacent digits into one byte: after this the 16-bit lanes of `pairs` hold HH, MM, SS and the first two digits of mmm
+        uint64_t digits = high - 0x3030303030303030ull;
+        uint64_t pairs = ((digits * 10) + (digits >> 8)) & 0x00FF00FF00FF00FFull;
+        uint32_t lowDigits = low - 0x30303030u;
+
+        uint32_t hours = static_cast<uint32_t>(pairs & 0xFF);
+        uint32_t minutes = static_cast<uint32_t>((pairs >> 16) & 0xFF);
+        uint32_t seconds = static_cast<uint32_t>((pairs >> 32) & 0xFF);
+        uint32_t milliseconds = static_cast<uint32_t>((pairs >> 48) & 0xFF) * 10 + (lowDigits & 0xFF);
+        // Hour 24 exists on days that are 25 hours long, when the clocks go back
+        if (hours > 24 || minutes > 59 || seconds > 59) {
+            error = VirgilDecodeError(VirgilErrorCode::invalidMessageID, "MessageID");
+            error.input = id;
+            error.expected = "must be a time of day, HHMMSSmmm###";
+            return false;
+        }
+        msSinceMidnight = ((hours * 60 + minutes) * 60 + seconds) * 1000 + milliseconds;
+
+        // Extract message index from last 3 digits (### portion of HHMMSSmmm###)
+        index = static_cast<uint16_t>(((lowDigits >> 8) & 0xFF) * 100 + ((lowDigits >> 16) & 0xFF) * 10 + (lowDigits >> 24));
+        return true;
+    }
+
+
+    // "00" to "99", so two digits can be written with one table lookup
+    static constexpr char DigitPairs[] =
+        "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+        "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+    // Writes two decimal digits of a value below 100.
+    static void WritePair(char* out, uint32_t value) {
+        out[0] = DigitPairs[value * 2];
+        out[1] = DigitPairs[value * 2 + 1];
+    }
+
+    // Writes the 12 digits of HHMMSSmmm### to out.
+    void WriteDigits(char* out) const {
+        if (messageIndex > 999)
+            VirgilThrowInvalidArgument("MessageID messageIndex (" + std::to_string(messageIndex) + 
+                ") does not fit in the 3 digits of the HHMMSSmmm### format");
+        // Calculate ms since midnight for this timeSent
+        std::chrono::system_clock::time_point midnight = LocalMidnight(timeSent);
+        uint32_t ms = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(timeSent - midnight).count());
+        uint32_t hour = ms / 3600000;
+        ms %= 3600000;
+        uint32_t minute = ms / 60000;
+        ms %= 60000;
+        uint32_t second = ms / 1000;
+        ms %= 1000;
+        WritePair(out, hour);
+        WritePair(out + 2, minute);
+        WritePair(out + 4, second);
+        out[6] = static_cast<char>('0' + ms / 100);
+        WritePair(out + 7, ms % 100);
+        out[9] = static_cast<char>('0' + messageIndex / 100);
+        WritePair(out + 10, messageIndex % 100);
+    }
+
+    // Reads sizeof(T) bytes as a little-endian integer, regardless of platform byte order or alignment.
+    // Compilers turn this into a single load on little-endian targets.
+    template <class T>
+    static T LoadLittleEndian(const char* bytes) {
+        T value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+            value |= static_cast<T>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+        return value;
+    }
+
+    // Checks that every byte of a word is an ASCII digit ('0' to '9').
+    template <class T>
+    static bool AllDigits(T word) {
+        constexpr T highNibbles = static_cast<T>(0xF0F0F0F0F0F0F0F0ull);
+        constexpr T zeros = static_cast<T>(0x3030303030303030ull);
+        constexpr T sixes = static_cast<T>(0x0606060606060606ull);
+        // Every byte must be 0x30-0x3F, and must stay below 0x40 after adding 6 (which rules out 0x3A-0x3F)
+        return (word & highNibbles) == zeros && ((word + sixes) & highNibbles) == zeros;
+    }
+
+};
+
+/**
+ * @brief A struct representing a unique channel identifier in the Virgil Protocol 2.3.0.
+ * 
+ * ChannelID combines a channel index (0-based) with a channel type to uniquely identify
+ * any channel within the Virgil audio network. This identifier is used throughout the
+ * protocol for routing audio, managing parameters, and establishing device connections.
+ * 
+ * Channel Type Meanings:
+ * - TX (0): Dante transmitting channels that send audio data to other devices
+ * - RX (1): Dante receiving channels that receive audio data from other devices  
+ * - AUX (2): Auxiliary channels for non-Dante device control (e.g., wall panels, dials)
+ * 
+ * Usage Patterns:
+ * - Audio routing: TX channels link to RX channels to establish audio flow
+ * - Parameter control: Each channel can have device-specific parameters (gain, phantom power, etc.)
+ * - Device discovery: Enumerate all channels during connection establishment
+ * - Status monitoring: Subscribe to parameter changes on specific channels
+ * 
+ * Linking Rules:
+ * - TX <-> RX: Bidirectional linking for audio flow (either side can initiate)
+ * - AUX -> Device: AUX channels link to devices, not other channels. The device with the aux channel cannot initiate.
+ * - Channel indices start at 0 and must correspond to actual device capabilities
+ * 
+ * JSON Serialization:
+ * - Standard fields: "channelIndex" and "channelType" 
+ * - Custom fields: Allow flexible field naming for different message contexts
+ * 
+ * @see Virgil Protocol 2.3.0 - "Channel Types" and "Linking Channels" sections
+ * @note Every Dante channel must have a corresponding Virgil channel with appropriate type
+ */
+struct ChannelID {
+    uint16_t channelIndex; // Index of the channel
+    LinkType channelType; // Type of the channel, e.g. "aux", "tx", "rx", "device"
+
+    ChannelID() : channelIndex(0), channelType(LinkType::tx) {}
+
+    // Constructor for when both channel index and type are provided
+    ChannelID(const int index, const LinkType type)
+    {
+        if(index < 0)
+            VirgilThrowInvalidArgument("Channel index (" + std::to_string(index) + ") cannot be negative. Valid range is 0 and above.");
+        channelType = type;
+        channelIndex = index;
+    }
+
+    // Scans a JSON object for channelIndex and channelType, and constructs a ChannelID.
+    ChannelID(const nlohmann::json& j) : ChannelID(j, "channelIndex", "channelType") {}
+
+    // Scans a JSON object for channelIndex and channelType with custom field names, and constructs a ChannelID.
+    // @throws VirgilDecodeException if either field is missing, not an unsigned integer, or out of range
+    ChannelID(const nlohmann::json& j, const std::string& channelindexName, const std::string& channelTypeName)
+        : ChannelID(TryFromJSON(j, channelindexName, channelTypeName).Value()) {}
+
+    /// @brief Same as the JSON constructors, but reports failures instead of throwing.
+    static VirgilResult<ChannelID> TryFromJSON(const nlohmann::json& j, const std::string& channelindexName = "channelIndex", 
+        const std::string& channelTypeName = "channelType") {
+        uint64_t type = 0;
+        uint64_t index = 0;
+        VirgilDecodeError error;
+        if(!ReadField(j, channelTypeName, UINT8_MAX, "between 0 and 255", type, error) ||
+            !ReadField(j, channelindexName, UINT16_MAX, "between 0 and 65535", index, error))
+            return error;
+        ChannelID channel;
+        channel.channelType = static_cast<LinkType>(type);
+        channel.channelIndex = static_cast<uint16_t>(index);
+        return channel;
+    }
+
+    // Converts the ChannelID to a JSON object with field names of "channelIndex" and "channelType".
+    // @return A JSON object containing only "channelIndex" and "channelType" fields if they are set.
+    nlohmann::json to_json() const {
+        return to_json("channelIndex", "channelType");
+    }
+
+    // Converts the ChannelID to a JSON object with custom field names.
+    // @param channelindexName The field name to store the channel index in.
+    // @param channelTypeName The field name to store the channel type in.
+    // @return A JSON object containing only the specified fields if they are set.
+    nlohmann::json to_json(const std::string& channelindexName, const std::string& channelTypeName) const {
+        nlohmann::json j;
+        j[channelindexName] = channelIndex;
+        j[channelTypeName] = channelType;
+        return j;
+    }
+
+    // Appends the ChannelID fields to an existing JSON object with custom field names.
+    // @param j The JSON object to append to. It does not clear existing fields, but will overwrite the fields if they already exist.
+    // @param channelindexName The field name to store the channel index in.
+    // @param channelTypeName The field name to store the channel type in.
+    void AppendJson(nlohmann::json& j, const std::string& channelindexName, const std::string& channelTypeName) const {
+        j[channelindexName] = channelIndex;
+        j[channelTypeName] = channelType;
+    }
+
+    // Appends the ChannelID fields to an existing JSON object with field names of "channelIndex" and "channelType".
+    // @param j The JSON object to append to. It does not clear existing fields, but will overwrite the fields if they already exist.
+    void AppendJson(nlohmann::json& j) const {
+        AppendJson(j, "channelIndex", "channelType");
+    }
+
+    // Appends the ChannelID fields to a JsonWriter that is inside an object, with custom field names.
+    // @param writer The writer to append to.
+    // @param channelindexName The field name to store the channel index in.
+    // @param channelTypeName The field name to store the channel type in.
+    void AppendJson(JsonWriter& writer, std::string_view channelindexName, std::string_view channelTypeName) const {
+        writer.Key(channelindexName);
+        writer.Unsigned(channelIndex);
+        writer.Key(channelTypeName);
+        writer.Unsigned(static_cast<uint8_t>(channelType));
+    }
+
+    // Appends the ChannelID fields to a JsonWriter that is inside an object, with field names of "channelIndex" and "channelType".
+    void AppendJson(JsonWriter& writer) const {
+        AppendJson(writer, "channelIndex", "channelType");
+    }
+
+
+    // Checks if the channel is an auxiliary channel.
+    bool IsAux() const {
+        return channelType == LinkType::aux;
+    }
+
+    // Checks if the channel is a transmit channel.
+    bool IsTx() const {
+        return channelType == LinkType::tx;
+    }
+
+    // Checks if the channel is a receive channel.
+    bool IsRx() const {
+        return channelType == LinkType::rx;
+    }
+
+    // Gets the index of the channel.
+    // @return The channel index.
+    // @throws std::runtime_error if the channel is device-level (no index) or if the index is not set.
+    int GetIndex() const {
+        return channelIndex;
+    }
+
+    bool operator==(const ChannelID& other) const {
+        return channelIndex == other.channelIndex && channelType == other.channelType;
+    }
+    bool operator!=(const ChannelID& other) const {
+        return !(*this == other);
+    }
+
+private:
+    // Reads one unsigned channel field with a single lookup, checking its type and range.
+    // Returns false and fills in error on failure.
+    static bool ReadField(const nlohmann::json& j, const std::string& fieldName, uint64_t max, const char* range, uint64_t& out, VirgilDecodeError& error) {
+        auto field = j.find(fieldName);
+        if(field != j.end() && field->is_number_unsigned() && field->get<uint64_t>() <= max) {
+            out = field->get<uint64_t>();
+            return true;
+        }
+
+        // Only failures pay for classifying the field name
+        std::optional<VirgilKey> key = ParseVirgilKey(fieldName);
+        if(field == j.end())
+            error = key ? VirgilDecodeError::MissingField("ChannelID", *key) : VirgilDecodeError::MissingField("ChannelID", fieldName);
+        else if(!field->is_number_unsigned()) {
+            const char* received = field->is_number_integer() ? "negative integer" : field->type_name();
+            error = key ? VirgilDecodeError::WrongType(nullptr, *key, "an unsigned integer", received) : 
+                VirgilDecodeError::WrongType(nullptr, fieldName, "an unsigned integer", received);
+        }
+        else {
+            error = VirgilDecodeError(VirgilErrorCode::outOfRange, nullptr, key);
+            error.number = field->get<uint64_t>();
+            error.expected = range;
+            if(!key)
+                error.input = fieldName;
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief Shares one immutable copy of equal values for as long as anything uses it.
+ * 
+ * Entries are held weakly: when the last shared_ptr to a value is released, its entry is erased.
+ * The cache therefore only holds values that are in use, however many distinct values peers send.
+ * Used to intern enum value lists, parameter descriptors and channel layouts.
+ * 
+ * A cache must outlive every value it hands out, so caches are created once and never destroyed.
+ * 
+ * @note Thread-safe. Looking up a value that is already interned does not allocate
+ */
+template <class T>
+class InternCache {
+public:
+    /**
+     * @brief Gets the shared copy of a value, adding it if no equal value is in use.
+     * @param hash Hash of the value. Equal values must have equal hashes
+     * @param matches Called with each cached value of the same hash. Returns true if it equals the wanted value
+     * @param make Called, at most once, to build the value if it is not cached
+     */
+    template <class Matches, class Make>
+    std::shared_ptr<const T> Intern(size_t hash, const Matches& matches, Make&& make) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            if(auto found = Find(hash, matches))
+                return found;
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        // Another thread may have added it between the lookup and taking the lock
+        if(auto found = Find(hash, matches))
+            return found;
+        std::shared_ptr<const T> value(new T(make()), [this, hash](const T* released) { Release(hash, released); });
+        entries.emplace(hash, Entry{value.get(), value});
+        return value;
+    }
+
+private:
+    struct Entry {
+        const T* value; // Valid for as long as the entry exists: Release() erases the entry before deleting the value
+        std::weak_ptr<const T> owner;
+    };
+
+    std::shared_mutex mutex;
+    std::unordered_multimap<size_t, Entry> entries;
+
+    template <class Matches>
+    std::shared_ptr<const T> Find(size_t hash, const Matches& matches) const {
+        auto range = entries.equal_range(hash);
+        for(auto it = range.first; it != range.second; ++it) {
+            if(!matches(*it->second.value))
+                continue;
+            // Empty if the last user released the value and Release() is waiting for the lock
+            if(std::shared_ptr<const T> found = it->second.owner.lock())
+                return found;
+        }
+        return nullptr;
+    }
+
+    void Release(size_t hash, const T* released) {
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            auto range = entries.equal_range(hash);
+            for(auto it = range.first; it != range.second; ++it) {
+                if(it->second.value == released) {
+                    entries.erase(it);
+                    break;
+                }
+            }
+        }
+        delete released; // Outside the lock: deleting a value may release values of other caches
+    }
+};
+
+/**
+ * @brief A struct representing a string enumeration with validation for Virgil Protocol parameters.
+ * 
+ * VirgilEnum is used for parameters that accept only specific predefined string values.
+ * This is commonly used for device settings that have discrete options rather than
+ * continuous numeric ranges.
+ * 
+ * 
+ * The enum maintains both the current value and the complete list of valid values,
+ * enabling proper validation and UI generation (dropdown menus, radio buttons, etc.).
+ * The list is interned and shared by every enum with the same list, and the current value
+ * is stored as an index into it, so copying, validating and comparing enums never touch strings.
+ * 
+ * Validation ensures that:
+ * - At least one valid value exists in enumValues
+ * - The current value is present in the enumValues list
+ * - The enum can be safely serialized to/from JSON
+ * 
+ * @see Virgil Protocol 2.3.0 - "Parameter Structure" for enum parameter requirements
+ * @note An empty or invalid enum (where value is not in enumValues) will fail validation
+ */
+struct VirgilEnum {
+    /// @brief The list of valid values of an enum, shared by every VirgilEnum with the same list.
+    using ValueTable = std::vector<std::string>;
+
+    static constexpr uint16_t InvalidIndex = 0xFFFF; ///< Index of an enum whose value is not in its table
+
+    // Default constructor. This will be considered invalid until properly initialized.
+    VirgilEnum() = default;
+
+    /// @brief Constructor with value and enum values.
+    /// The list is interned (see InternValues()), so enums with the same list share one copy of it.
+    /// If val is not in the list, the enum is invalid.
+    VirgilEnum(std::string_view val, const ValueTable& enumVals)
+        : values(InternValues(enumVals)) {
+        SetValue(val);
+    }
+
+    /// @brief Constructor from a shared value table and the index of the current value.
+    VirgilEnum(std::shared_ptr<const ValueTable> table, uint16_t valueIndex)
+        : values(std::move(table)), index(valueIndex) {}
+
+    /**
+     * @brief Gets the shared copy of a list of enum values, adding it if no enum in use has the same list.
+     * 
+     * Every device reports the same lists for the same kind of parameter (e.g. transmitPower on each
+     * wireless channel), so storing each list once saves a vector of strings per parameter. A list is
+     * freed with the last enum that uses it, so lists received from peers are not kept forever.
+     * 
+     * @note Thread-safe. Looking up a list that is already interned does not allocate
+     */
+    static std::shared_ptr<const ValueTable> InternValues(const ValueTable& enumVals) {
+        return GetCache().Intern(HashValues(enumVals), 
+            [&](const ValueTable& table) { return table == enumVals; }, 
+            [&]() { return enumVals; });
+    }
+
+    /// @brief Gets the current value, or an empty string if the enum is invalid.
+    const std::string& GetValue() const {
+        static const std::string empty;
+        return *this ? (*values)[index] : empty;
+    }
+
+    /// @brief Gets the list of valid values. Empty if the enum has no table.
+    const ValueTable& GetValues() const {
+        static const ValueTable empty;
+        return values ? *values : empty;
+    }
+
+    /// @brief Gets the shared value table, e.g. to construct other enums with the same list.
+    const std::shared_ptr<const ValueTable>& GetTable() const {
+        return values;
+    }
+
+    /// @brief Gets the index of the current value in GetValues(), or InvalidIndex.
+    uint16_t GetIndex() const {
+        return index;
+    }
+
+    /// @brief Changes the current value.
+    /// @return False if val is not one of the valid values. The enum is then invalid.
+    bool SetValue(std::string_view val) {
+        index = InvalidIndex;
+        if(!values)
+            return false;
+        for(size_t i = 0; i < values->size() && i < InvalidIndex; ++i) {
+            if((*values)[i] == val) {
+                index = static_cast<uint16_t>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Validates the VirgilEnum's fields and returns true if valid, false otherwise.
+    // According to Virgil protocol, enums must have at least one valid value and the current value must be in the list.
+    // The index is only ever set to a position in the table, so this is a bounds check.
+    operator bool() const {
+        return values && index < values->size();
+    }
+
+    // Equal lists share one table, so this compares a pointer and an index.
+    bool operator==(const VirgilEnum& other) const {
+        if(!*this || !other)
+            VirgilThrowInvalidArgument("Cannot compare invalid VirgilEnums. Left enum valid=" + std::to_string(static_cast<bool>(*this)) + 
+                " (value='" + GetValue() + "'), Right enum valid=" + std::to_string(static_cast<bool>(other)) + 
+                " (value='" + other.GetValue() + "')");
+        return index == other.index && (values == other.values || *values == *other.values);
+    }
+
+    bool operator!=(const VirgilEnum& other) const {
+        return !(*this == other);
+    }
+
+private:
+    std::shared_ptr<const ValueTable> values; // Shared list of valid values
+    uint16_t index = InvalidIndex; // Index of the current value in values
+
+    static InternCache<ValueTable>& GetCache() {
+        static InternCache<ValueTable>* cache = new InternCache<ValueTable>(); // Never destroyed, see InternCache
+        return *cache;
+    }
+
+    static size_t HashValues(const ValueTable& enumVals) {
+        uint32_t hash = VirgilHash("");
+        for(const std::string& v : enumVals)
+            hash = VirgilHash(v, hash ^ static_cast<uint32_t>(v.size()));
+        return hash;
+    }
+};
+
+/**
+ * @brief A struct representing a Virgil Protocol parameter with validation and JSON serialization.
+ * 
+ * Parameters are the core data structure for controlling and monitoring audio device settings
+ * in the Virgil Protocol 2.3.0. Each parameter contains a current value, data type information,
+ * constraints, and metadata required for proper validation and UI generation.
+ * 
+ * Supported parameter types and their requirements:
+ * 
+ * **Control Parameters** (user-controllable):
+ * - gain (required): Analog gain, independent of pad. Units: dB. Type: int/float
+ * - pad: Input attenuator control. Type: bool
+ * - padLevel: Pad attenuation amount. Units: dB. Type: int (usually negative)
+ * - lowcut: High-pass filter frequency. Units: Hz. Type: int/float  
+ * - lowcutEnable: Enable/disable high-pass filter. Type: bool
+ * - polarity: Signal polarity (phase invert). Type: bool
+ * - phantomPower: Phantom power control. Type: bool
+ * - rfEnable: RF transmitter/receiver control. Type: bool
+ * - transmitPower: Transmitter power level. Type: enum/int/float. Units: %
+ * - squelch: Squelch threshold. Type: int/float. Units: dB or %
+ * 
+ * **Status Parameters** (read-only):
+ * - deviceConnected: Wireless device connection status. Type: bool
+ * - subDevice: Type of connected device. Type: string (handheld, beltpack, etc.)
+ * 
+ * **Continuous Parameters** (real-time monitoring, read-only):
+ * - audioLevel: Audio signal level. Type: float. Units: dBFS
+ * - rfLevel: RF signal strength. Type: int/float. Units: dB or %
+ * - batteryLevel: Battery level. Type: int. Units: %
+ * 
+ * **Special Parameters**:
+ * - linkedChannels: Mandatory array of linked channel information
+ * 
+ * Data type validation follows the formula for numeric parameters:
+ * `isValid = (value - minValue) % precision == 0 && value >= minValue && value <= maxValue`
+ * 
+ * @see Virgil Protocol 2.3.0 - "Parameters" section for complete specification
+ * @note Non-readonly numeric parameters must specify minValue, maxValue, and precision
+ * @note The list of parameters seen above is not checked anywhere. That is just what is specified in the current Virgil version. Aux channels are allowed to make things up.
+ */
+struct Parameter {
+    ParameterName name; // Parameter name, interned unless it was decoded (see ParameterName::Decoded())
+    ParameterType dataType = ParameterType::string; // Data type. Converted to the "dataType" string only when writing JSON
+    bool readOnly = false; // True if parameter is read-only
+
+    /// @brief Constructs a Parameter from a JSON object.
+    /// @param j The JSON object to parse. This should not contain the name.
+    /// @throws VirgilDecodeException under the same conditions that TryFromJSON() returns an error
+    Parameter(const std::string& paramName, const nlohmann::json& j) : Parameter(TryFromJSON(paramName, j).Value()) {}
+
+    /**
+     * @brief Same as the JSON constructor, but returns the error instead of throwing.
+     * 
+     * Every field is type checked before it is read, so a field of the wrong JSON type is a
+     * wrongType error rather than a nlohmann::json::type_error. The name is made with
+     * ParameterName::Decoded(), so names from a peer do not grow the interning table.
+     * 
+     * @param paramName The parameter name (its key in the message)
+     * @param j The JSON object to parse. This should not contain the name.
+     */
+    static VirgilResult<Parameter> TryFromJSON(const std::string& paramName, const nlohmann::json& j) {
+        std::optional<Parameter> param;
+        VirgilDecodeError error;
+        auto construct = [&](auto&&... args) { param.emplace(std::forward<decltype(args)>(args)...); };
+        if(!BuildFromJSON(paramName, j, construct, error))
+            return error;
+        return std::move(*param);
+    }
+
+    /**
+     * @brief Decodes a parameter object and constructs it directly at the end of a list.
+     * 
+     * This is what MessageFields::Read() uses for the parameters of an infoResponse: nothing is
+     * built and then moved, and the list can be reserve()d for the whole message up front.
+     * 
+     * @param list The list to append to, e.g. a ParameterList
+     * @return false, with error filled in and the list unchanged, under the same conditions that TryFromJSON() returns an error
+     */
+    template <class List>
+    static bool EmplaceFromJSON(List& list, const std::string& paramName, const nlohmann::json& j, VirgilDecodeError& error) {
+        auto construct = [&](auto&&... args) { list.emplace_back(std::forward<decltype(args)>(args)...); };
+        return BuildFromJSON(paramName, j, construct, error);
+    }
+
+    // Constructor for string parameters
+    Parameter(ParameterName paramName, const std::string& paramValue, bool isReadOnly)
+    {
+        VirgilDecodeError error;
+        if(!CheckName(paramName.to_string_view(), error))
+            VirgilThrowDecodeError(error);
+        name = std::move(paramName);
+        dataType = ParameterType::string;
+        text.emplace<std::string>(paramValue);
+        readOnly = isReadOnly;
+    }
+
+    // Constructor for VirgilEnum parameters. These are just strings with a predefined set of valid values.
+    Parameter(ParameterName paramName, const VirgilEnum& paramValue, bool isReadOnly)
+    {
+        VirgilDecodeError error;
+        if(!CheckName(paramName.to_string_view(), error))
+            VirgilThrowDecodeError(error);
+        if(!paramValue)
+            VirgilThrowDecodeError(VirgilDecodeError::InvalidValue("Enum parameter", VirgilKey::value, {}, "is not in its enumValues list", paramName.to_string_view()));
+        name = std::move(paramName);
+        dataType = ParameterType::enumeration;
+        text.emplace<VirgilEnum>(paramValue);
+        readOnly = isReadOnly;
+    }
+
+    // Constructor for int parameters
+    Parameter(ParameterName paramName, int paramValue, bool isReadOnly, const std::string& unitStr, std::optional<int> minVal, std::optional<int> maxVal, std::optional<int> prec)
+    {
+        VirgilDecodeError error;
+        if(!CheckName(paramName.to_string_view(), error) || !CheckNumber(paramName.to_string_view(), paramValue, isReadOnly, unitStr, minVal, maxVal, prec, error))
+            VirgilThrowDecodeError(error);
+        name = std::move(paramName);
+        dataType = ParameterType::integer;
+        number.i = paramValue;
+        text.emplace<std::string>(unitStr);
+        SetConstraint(MinValueBit, minValue, minVal);
+        SetConstraint(MaxValueBit, maxValue, maxVal);
+        SetConstraint(PrecisionBit, precision, prec);
+        readOnly = isReadOnly;
+    }
+
+    // Constructor for float parameters
+    Parameter(ParameterName paramName, float paramValue, bool isReadOnly, const std::string& unitStr, std::optional<float> minVal, std::optional<float> maxVal, std::optional<float> prec)
+    {
+        VirgilDecodeError error;
+        if(!CheckName(paramName.to_string_view(), error) || !CheckNumber(paramName.to_string_view(), paramValue, isReadOnly, unitStr, minVal, maxVal, prec, error))
+            VirgilThrowDecodeError(error);
+        name = std::move(paramName);
+        dataType = ParameterType::floating;
+        number.f = paramValue;
+        text.emplace<std::string>(unitStr);
+        SetConstraint(MinValueBit, minValue, minVal);
+        SetConstraint(MaxValueBit, maxValue, maxVal);
+        SetConstraint(PrecisionBit, precision, prec);
+        readOnly = isReadOnly;
+    }
+
+    // Constructor for bool parameters
+    Parameter(ParameterName paramName, const bool paramValue, bool isReadOnly)
+    {
+        VirgilDecodeError error;
+        if(!CheckName(paramName.to_string_view(), error))
+            VirgilThrowDecodeError(error);
+        name = std::move(paramName);
+        dataType = ParameterType::boolean;
+        number.b = paramValue;
+        readOnly = isReadOnly;
+    }
+
+    /// @brief Checks, without throwing, that a parameter name is valid for the constructors.
+    static bool CheckName(std::string_view paramName, VirgilDecodeError& error) {
+        if(!paramName.empty())
+            return true;
+        error = VirgilDecodeError::InvalidValue("Parameter", std::nullopt, {}, "name cannot be empty");
+        return false;
+    }
+
+    /**
+     * @brief Checks, without throwing, the arguments of the int and float constructors.
+     * 
+     * The unit must not be empty, minValue must not be greater than maxValue, and precision must be positive.
+     * Writable parameters must have all three constraints, and writable int parameters must start on
+     * a step of precision between minValue and maxValue.
+     * 
+     * @return false, with error filled in, if the constructor would throw
+     */
+    template <class T>
+    static bool CheckNumber(std::string_view paramName, T paramValue, bool isReadOnly, std::string_view unitStr, 
+        std::optional<T> minVal, std::optional<T> maxVal, std::optional<T> prec, VirgilDecodeError& error) {
+        constexpr bool isInt = std::is_same_v<T, int>;
+        const char* owner = isInt ? "Integer parameter" : "Float parameter";
+        auto format = [](T value) {
+            return isInt ? VirgilDecodeError::Excerpt::Number(static_cast<int64_t>(value)) : VirgilDecodeError::Excerpt::Number(static_cast<double>(value));
+        };
+        if(unitStr.empty())
+            error = VirgilDecodeError::InvalidValue(owner, VirgilKey::unit, {}, "cannot be empty", paramName);
+        else if(minVal && maxVal && *minVal > *maxVal)
+            error = VirgilDecodeError::InvalidValue(owner, VirgilKey::minValue, format(*minVal).view(), "cannot be greater than maxValue", paramName);
+        else if(prec && *prec <= 0)
+            error = VirgilDecodeError::InvalidValue(owner, VirgilKey::precision, format(*prec).view(), "must be greater than 0", paramName);
+        else if(!isReadOnly && (!minVal || !maxVal || !prec))
+            error = VirgilDecodeError::MissingField(isInt ? "Writable integer parameter" : "Writable float parameter", 
+                !minVal ? VirgilKey::minValue : !maxVal ? VirgilKey::maxValue : VirgilKey::precision, paramName);
+        else {
+            if constexpr (isInt) {
+                // Range first, then the step in 64 bits: paramValue - minVal does not fit in an int for every pair of ints
+                if(!isReadOnly && (paramValue < *minVal || paramValue > *maxVal ||
+                    (static_cast<int64_t>(paramValue) - *minVal) % *prec != 0)) {
+                    error = VirgilDecodeError::InvalidValue(owner, VirgilKey::value, format(paramValue).view(), 
+                        "is not between minValue and maxValue in steps of precision", paramName);
+                    return false;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief Gets the value of an int parameter.
+    /// @throws std::invalid_argument if the parameter is not an int parameter
+    int GetInt() const {
+        RequireType(ParameterType::integer);
+        return number.i;
+    }
+
+    /// @brief Gets the value of a float parameter.
+    /// @throws std::invalid_argument if the parameter is not a float parameter
+    float GetFloat() const {
+        RequireType(ParameterType::floating);
+        return number.f;
+    }
+
+    /// @brief Gets the value of a bool parameter.
+    /// @throws std::invalid_argument if the parameter is not a bool parameter
+    bool GetBool() const {
+        RequireType(ParameterType::boolean);
+        return number.b;
+    }
+
+    /// @brief Gets the value of a string parameter.
+    /// @throws std::invalid_argument if the parameter is not a string parameter
+    const std::string& GetString() const {
+        RequireType(ParameterType::string);
+        return std::get<std::string>(text);
+    }
+
+    /// @brief Gets the value of an enum parameter.
+    /// @throws std::invalid_argument if the parameter is not an enum parameter
+    const VirgilEnum& GetEnum() const {
+        RequireType(ParameterType::enumeration);
+        return std::get<VirgilEnum>(text);
+    }
+
+    /// @brief Gets the unit of an int or float parameter, or std::nullopt for other types.
+    std::optional<std::string_view> GetUnit() const {
+        if(!IsNumber())
+            return std::nullopt;
+        return std::string_view(std::get<std::string>(text));
+    }
+
+    // Gets the constraints of an int or float parameter. Each holds the parameter's own number type.
+    std::optional<std::variant<int,float>> GetMinValue() const { return GetConstraint(MinValueBit, minValue); }
+    std::optional<std::variant<int,float>> GetMaxValue() const { return GetConstraint(MaxValueBit, maxValue); }
+    std::optional<std::variant<int,float>> GetPrecision() const { return GetConstraint(PrecisionBit, precision); }
+
+    /// @brief Changes the value of an int parameter. Constraints are not checked.
+    /// @throws std::invalid_argument if the parameter is not an int parameter
+    void SetInt(int newValue) {
+        RequireType(ParameterType::integer);
+        number.i = newValue;
+    }
+
+    /// @brief Changes the value of a float parameter. Constraints are not checked.
+    /// @throws std::invalid_argument if the parameter is not a float parameter
+    void SetFloat(float newValue) {
+        RequireType(ParameterType::floating);
+        number.f = newValue;
+    }
+
+    /// @brief Changes the value of a bool parameter.
+    /// @throws std::invalid_argument if the parameter is not a bool parameter
+    void SetBool(bool newValue) {
+        RequireType(ParameterType::boolean);
+        number.b = newValue;
+    }
+
+    /// @brief Changes the value of a string parameter, or selects a value of an enum parameter.
+    /// @throws std::invalid_argument if the parameter is not a string or enum parameter, or the value is not one of the enum's values
+    void SetString(std::string_view newValue) {
+        if(dataType == ParameterType::enumeration) {
+            VirgilEnum& enumValue = std::get<VirgilEnum>(text);
+            uint16_t previous = enumValue.GetIndex();
+            if(!enumValue.SetValue(newValue)) {
+                enumValue = VirgilEnum(enumValue.GetTable(), previous);
+                VirgilThrowInvalidArgument("Enum parameter '" + name.to_string() + "' has no value '" + std::string(newValue) + "'");
+            }
+            return;
+        }
+        RequireType(ParameterType::string);
+        std::get<std::string>(text).assign(newValue);
+    }
+
+    // Converts the Parameter to a JSON object for sending. This does not contain the name field.
+    nlohmann::json to_json() const {
+
+        if(name.empty())
+            VirgilThrowInvalidArgument("Parameter name cannot be empty when converting to JSON. Parameter has dataType='" + 
+                std::string(ParameterTypeName(dataType)) + "' but missing name");
+        nlohmann::json j;
+        j["dataType"] = ParameterTypeName(dataType);
+
+        switch(dataType) {
+            case ParameterType::string:
+                j["value"] = std::get<std::string>(text);
+                break;
+            case ParameterType::enumeration:
+                j["value"] = std::get<VirgilEnum>(text).GetValue();
+                j["enumValues"] = std::get<VirgilEnum>(text).GetValues();
+                break;
+            case ParameterType::boolean:
+                j["value"] = number.b;
+                break;
+            case ParameterType::integer:
+            case ParameterType::floating:
+                SetNumber(j["value"], number);
+                break;
+        }
+
+        j["readOnly"] = readOnly;
+        if(IsNumber()) {
+            j["unit"] = std::get<std::string>(text);
+            if(present & MinValueBit)
+                SetNumber(j["minValue"], minValue);
+            if(present & MaxValueBit)
+                SetNumber(j["maxValue"], maxValue);
+            if(present & PrecisionBit)
+                SetNumber(j["precision"], precision);
+        }
+        return j;
+    }
+
+    // Appends the Parameter to an existing JSON object with the name as the key.
+    void append_json(nlohmann::json& j) const {
+        j[name.to_string()] = to_json();
+    }
+
+    /// @brief Appends the Parameter to a JsonWriter that is inside an object, with the name as the key.
+    /// Writes the same fields as to_json().
+    /// @throws std::invalid_argument if the parameter has no name
+    void append_json(JsonWriter& writer) const {
+        if(name.empty())
+            VirgilThrowInvalidArgument("Parameter name cannot be empty when converting to JSON. Parameter has dataType='" + 
+                std::string(ParameterTypeName(dataType)) + "' but missing name");
+        writer.Key(name.to_string_view());
+        writer.BeginObject();
+        writer.Key("dataType");
+        writer.String(ParameterTypeName(dataType));
+        writer.Key("value");
+        switch(dataType) {
+            case ParameterType::string:
+                writer.String(std::get<std::string>(text));
+                break;
+            case ParameterType::enumeration:
+                writer.String(std::get<VirgilEnum>(text).GetValue());
+                writer.Key("enumValues");
+                writer.BeginArray();
+                for (const std::string& enumValue : std::get<VirgilEnum>(text).GetValues())
+                    writer.String(enumValue);
+                writer.EndArray();
+                break;
+            case ParameterType::boolean:
+                writer.Bool(number.b);
+                break;
+            case ParameterType::integer:
+            case ParameterType::floating:
+                WriteNumber(writer, number);
+                break;
+        }
+        writer.Key("readOnly");
+        writer.Bool(readOnly);
+        if(IsNumber()) {
+            writer.Key("unit");
+            writer.String(std::get<std::string>(text));
+            if(present & MinValueBit) {
+                writer.Key("minValue");
+                WriteNumber(writer, minValue);
+            }
+            if(present & MaxValueBit) {
+                writer.Key("maxValue");
+                WriteNumber(writer, maxValue);
+            }
+            if(present & PrecisionBit) {
+                writer.Key("precision");
+                WriteNumber(writer, precision);
+            }
+        }
+        writer.EndObject();
+    }
+
+    // Validates the Parameter's fields and returns true if valid, false otherwise.
+    // This ensures the parameter conforms to Virgil Protocol 2.3.0 parameter requirements.
+    // The value always has the type dataType names, since it can only be set through the typed constructors and setters.
+    operator bool() const {
+        // Basic validation: parameter must have a name
+        if(name.empty())
+            return false;
+
+        switch(dataType) {
+            // Validate enum parameters according to Virgil protocol requirements
+            case ParameterType::enumeration:
+                // The enum itself must be valid (value in enumValues list)
+                return static_cast<bool>(std::get<VirgilEnum>(text));
+            // Validate numeric parameters (int/float) according to Virgil protocol requirements
+            case ParameterType::integer:
+            case ParameterType::floating:
+                // For non-readonly numeric parameters, Virgil protocol requires minValue, maxValue, and precision
+                // This allows proper validation and UI generation
+                if(!readOnly && (present & AllConstraintBits) != AllConstraintBits)
+                    return false;
+                return true;
+            // Boolean and string parameters have no further requirements
+            case ParameterType::boolean:
+            case ParameterType::string:
+                return true;
+        }
+        return false; // Unknown/unsupported dataType
+    }
+
+private:
+    // An int, float or bool. Which one is stored is given by dataType.
+    union Number {
+        int i;
+        float f;
+        bool b;
+    };
+
+    static constexpr uint8_t MinValueBit = 1;
+    static constexpr uint8_t MaxValueBit = 2;
+    static constexpr uint8_t PrecisionBit = 4;
+    static constexpr uint8_t AllConstraintBits = MinValueBit | MaxValueBit | PrecisionBit;
+
+    uint8_t present = 0; // Which of minValue, maxValue and precision are set
+    Number number = {0}; // Value of int, float and bool parameters
+    Number minValue = {0}; // Constraints of int and float parameters, in the same type as the value
+    Number maxValue = {0};
+    Number precision = {0};
+    // Value of string parameters (the string), enum parameters (the VirgilEnum) and the unit of int and float parameters (the string).
+    // Strings up to the standard library's small-string size are stored inline; longer ones are allocated.
+    std::variant<std::string, VirgilEnum> text;
+
+    bool IsNumber() const {
+        return dataType == ParameterType::integer || dataType == ParameterType::floating;
+    }
+
+    void RequireType(ParameterType type) const {
+        if(dataType != type)
+            VirgilThrowInvalidArgument("Parameter '" + name.to_string() + "' has dataType '" + std::string(ParameterTypeName(dataType)) + 
+                "', not '" + std::string(ParameterTypeName(type)) + "'");
+    }
+
+    template <class T>
+    void SetConstraint(uint8_t bit, Number& target, const std::optional<T>& source) {
+        if(!source)
+            return;
+        if constexpr (std::is_same_v<T, int>)
+            target.i = *source;
+        else
+            target.f = *source;
+        present |= bit;
+    }
+
+    // The fields of a parameter object, found with one pass over its keys. nullptr if absent.
+    struct JsonFields {
+        const nlohmann::json* dataType = nullptr;
+        const nlohmann::json* value = nullptr;
+        const nlohmann::json* readOnly = nullptr;
+        const nlohmann::json* unit = nullptr;
+        const nlohmann::json* constraints[3] = {}; // minValue, maxValue, precision, in VirgilKey order
+        const nlohmann::json* enumValues = nullptr;
+    };
+
+    // Classifies every key of a parameter object with ParseVirgilKey(), instead of looking each field up by name.
+    static JsonFields FindFields(const nlohmann::json& j) {
+        JsonFields fields;
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            std::optional<VirgilKey> key = ParseVirgilKey(it.key());
+            if(!key)
+                continue;
+            const nlohmann::json* value = &it.value();
+            switch(*key) {
+                case VirgilKey::dataType: fields.dataType = value; break;
+                case VirgilKey::value: fields.value = value; break;
+                case VirgilKey::readOnly: fields.readOnly = value; break;
+                case VirgilKey::unit: fields.unit = value; break;
+                case VirgilKey::minValue:
+                case VirgilKey::maxValue:
+                case VirgilKey::precision:
+                    fields.constraints[static_cast<size_t>(*key) - static_cast<size_t>(VirgilKey::minValue)] = value;
+                    break;
+                case VirgilKey::enumValues: fields.enumValues = value; break;
+                default: break; // Message-level keys mean nothing inside a parameter
+            }
+        }
+        return fields;
+    }
+
+    // Validates a parameter object, then passes the constructor arguments to construct(). Shared by TryFromJSON() and EmplaceFromJSON().
+    template <class Construct>
+    static bool BuildFromJSON(const std::string& paramName, const nlohmann::json& j, Construct& construct, VirgilDecodeError& error) {
+        auto fail = [&](const VirgilDecodeError& failure) {
+            error = failure;
+            return false;
+        };
+        if(!CheckName(paramName, error))
+            return false;
+        if(!j.is_object())
+            return fail(VirgilDecodeError::NotAnObject("Parameter", j.type_name()));
+
+        // Validates presence of required fields
+        JsonFields fields = FindFields(j);
+        if(!fields.dataType)
+            return fail(VirgilDecodeError::MissingField("Parameter", VirgilKey::dataType, paramName));
+        if(!fields.value)
+            return fail(VirgilDecodeError::MissingField("Parameter", VirgilKey::value, paramName));
+        if(!fields.readOnly)
+            return fail(VirgilDecodeError::MissingField("Parameter", VirgilKey::readOnly, paramName));
+
+        if(!fields.readOnly->is_boolean())
+            return fail(VirgilDecodeError::WrongType("Parameter", VirgilKey::readOnly, "a boolean", fields.readOnly->type_name(), paramName));
+        bool isReadOnly = fields.readOnly->get<bool>();
+        if(!fields.dataType->is_string())
+            return fail(VirgilDecodeError::WrongType("Parameter", VirgilKey::dataType, "a string", fields.dataType->type_name(), paramName));
+        const std::string& dataTypeStr = fields.dataType->get_ref<const std::string&>();
+        std::optional<ParameterType> type = ParseParameterType(dataTypeStr);
+        if(!type)
+            return fail(VirgilDecodeError::UnknownDataType(paramName, dataTypeStr));
+
+        // Parses based on dataType
+        const nlohmann::json& valueField = *fields.value;
+        switch(*type) {
+            case ParameterType::string:
+                if(!valueField.is_string())
+                    return fail(VirgilDecodeError::WrongType("Parameter", VirgilKey::value, "a string", valueField.type_name(), paramName));
+                construct(ParameterName::Decoded(paramName), valueField.get_ref<const std::string&>(), isReadOnly);
+                return true;
+            case ParameterType::boolean:
+                if(!valueField.is_boolean())
+                    return fail(VirgilDecodeError::WrongType("Parameter", VirgilKey::value, "a boolean", valueField.type_name(), paramName));
+                construct(ParameterName::Decoded(paramName), valueField.get<bool>(), isReadOnly);
+                return true;
+            case ParameterType::enumeration: {
+                if(!valueField.is_string())
+                    return fail(VirgilDecodeError::WrongType("Parameter", VirgilKey::value, "a string", valueField.type_name(), paramName));
+                if(!fields.enumValues)
+                    return fail(VirgilDecodeError::MissingField("Enum parameter", VirgilKey::enumValues, paramName));
+                if(!fields.enumValues->is_array())
+                    return fail(VirgilDecodeError::WrongType("Enum parameter", VirgilKey::enumValues, "an array of strings", fields.enumValues->type_name(), paramName));
+                VirgilEnum::ValueTable enumValues;
+                enumValues.reserve(fields.enumValues->size());
+                for(const nlohmann::json& entry : *fields.enumValues) {
+                    if(!entry.is_string())
+                        return fail(VirgilDecodeError::WrongType("Enum parameter", VirgilKey::enumValues, "an array of strings", entry.type_name(), paramName));
+                    enumValues.push_back(entry.get_ref<const std::string&>());
+                }
+                const std::string& value = valueField.get_ref<const std::string&>();
+                VirgilEnum enumValue(value, enumValues);
+                if(!enumValue)
+                    return fail(VirgilDecodeError::InvalidValue("Enum parameter", std::nullopt, value, "is not in its enumValues list", paramName));
+                construct(ParameterName::Decoded(paramName), enumValue, isReadOnly);
+                return true;
+            }
+            case ParameterType::integer:
+                return BuildNumberFromJSON<int>(paramName, fields, isReadOnly, construct, error);
+            case ParameterType::floating:
+                return BuildNumberFromJSON<float>(paramName, fields, isReadOnly, construct, error);
+        }
+        return fail(VirgilDecodeError::UnknownDataType(paramName, dataTypeStr));
+    }
+
+    // Reads the fields of an int or float parameter for BuildFromJSON().
+    template <class T, class Construct>
+    static bool BuildNumberFromJSON(const std::string& paramName, const JsonFields& fields, bool isReadOnly, Construct& construct, VirgilDecodeError& error) {
+        auto fail = [&](const VirgilDecodeError& failure) {
+            error = failure;
+            return false;
+        };
+        const char* owner = std::is_same_v<T, int> ? "Integer parameter" : "Float parameter";
+        if(!fields.unit)
+            return fail(VirgilDecodeError::MissingField(owner, VirgilKey::unit, paramName));
+        if(!fields.unit->is_string())
+            return fail(VirgilDecodeError::WrongType("Parameter", VirgilKey::unit, "a string", fields.unit->type_name(), paramName));
+        T value;
+        if(!ReadNumber(*fields.value, VirgilKey::value, paramName, value, error))
+            return false;
+
+        std::optional<T> constraints[3];
+        for(size_t i = 0; i < 3; ++i) {
+            const nlohmann::json* field = fields.constraints[i];
+            VirgilKey key = static_cast<VirgilKey>(static_cast<size_t>(VirgilKey::minValue) + i);
+            if(field && !ReadNumber(*field, key, paramName, constraints[i].emplace(), error))
+                return false;
+        }
+
+        const std::string& unitStr = fields.unit->get_ref<const std::string&>();
+        if(!CheckNumber(paramName, value, isReadOnly, unitStr, constraints[0], constraints[1], constraints[2], error))
+            return false;
+        construct(ParameterName::Decoded(paramName), value, isReadOnly, unitStr, constraints[0], constraints[1], constraints[2]);
+        return true;
+    }
+
+    // Reads a numeric field of an int or float parameter. int fields must be integers that fit an int, and float fields numbers that fit a float.
+    template <class T>
+    static bool ReadNumber(const nlohmann::json& field, VirgilKey key, const std::string& paramName, T& out, VirgilDecodeError& error) {
+        if(!field.is_number()) {
+            error = VirgilDecodeError::WrongType("Parameter", key, "a number", field.type_name(), paramName);
+            return false;
+        }
+        if constexpr (std::is_same_v<T, int>) {
+            if(!field.is_number_integer()) {
+                error = VirgilDecodeError::WrongType("Integer parameter", key, "an integer", "floating-point number", paramName);
+                return false;
+            }
+            const char* range = "between -2147483648 and 2147483647";
+            if(field.is_number_unsigned() && field.get<uint64_t>() > static_cast<uint64_t>(INT_MAX)) {
+                error = VirgilDecodeError::OutOfRange("Integer parameter", key, std::to_string(field.get<uint64_t>()), range, paramName);
+                return false;
+            }
+            int64_t value = field.get<int64_t>();
+            if(value < INT_MIN || value > INT_MAX) {
+                error = VirgilDecodeError::OutOfRange("Integer parameter", key, VirgilDecodeError::Excerpt::Number(value), range, paramName);
+                return false;
+            }
+            out = static_cast<int>(value);
+        }
+        else {
+            double value = field.get<double>();
+            if(std::fabs(value) > FLT_MAX) {
+                error = VirgilDecodeError::OutOfRange("Float parameter", key, VirgilDecodeError::Excerpt::Number(value), "within the range of a float", paramName);
+                return false;
+            }
+            out = static_cast<float>(value);
+        }
+        return true;
+    }
+
+    std::optional<std::variant<int,float>> GetConstraint(uint8_t bit, const Number& source) const {
+        if(!(present & bit))
+            return std::nullopt;
+        if(dataType == ParameterType::integer)
+            return std::variant<int,float>(source.i);
+        return std::variant<int,float>(source.f);
+    }
+
+    // Writes a number in the parameter's number type.
+    void SetNumber(nlohmann::json& target, const Number& source) const {
+        if(dataType == ParameterType::integer)
+            target = source.i;
+        else
+            target = source.f;
+    }
+
+    void WriteNumber(JsonWriter& writer, const Number& source) const {
+        if(dataType == ParameterType::integer)
+            writer.Int(source.i);
+        else
+            writer.Float(source.f);
+    }
+};
+
+/**
+ * @brief The immutable description of a parameter: everything about it except its current value.
+ * 
+ * Descriptors are interned with Intern(), so channels whose parameters have identical constraints
+ * (such as 64 identical preamp channels) share one descriptor. A shared descriptor is never modified:
+ * a channel whose constraints change is given a different interned descriptor instead.
+ * 
+ * @see ChannelParameters for the per-channel value store that uses these
+ */
+struct ParameterDescriptor {
+    ParameterName name; // Parameter name
+    ParameterType dataType = ParameterType::string; // Type of the value
+    bool readOnly = false; // True if parameter is read-only
+    std::string unit; // Unit of int and float parameters, empty otherwise
+    std::optional<std::variant<int,float>> minValue; // Constraints of int and float parameters
+    std::optional<std::variant<int,float>> maxValue;
+    std::optional<std::variant<int,float>> precision;
+    std::shared_ptr<const VirgilEnum::ValueTable> enumValues; // Interned value list of enum parameters, nullptr otherwise
+
+    ParameterDescriptor() = default;
+
+    /// @brief Constructs the descriptor of an existing parameter.
+    explicit ParameterDescriptor(const Parameter& param)
+        : name(param.name), dataType(param.dataType), readOnly(param.readOnly),
+          minValue(param.GetMinValue()), maxValue(param.GetMaxValue()), precision(param.GetPrecision()) {
+        if(std::optional<std::string_view> paramUnit = param.GetUnit())
+            unit = *paramUnit;
+        if(dataType == ParameterType::enumeration)
+            enumValues = param.GetEnum().GetTable();
+    }
+
+    /// @brief Gets the shared copy of a descriptor, adding it if no identical descriptor is in use.
+    /// A descriptor is freed with the last layout that uses it.
+    /// @note Thread-safe
+    static std::shared_ptr<const ParameterDescriptor> Intern(const ParameterDescriptor& descriptor) {
+        return GetCache().Intern(descriptor.Hash(), 
+            [&](const ParameterDescriptor& cached) { return cached == descriptor; }, 
+            [&]() { return descriptor; });
+    }
+
+    // Enum value lists are interned, so they are compared by pointer.
+    bool operator==(const ParameterDescriptor& other) const {
+        return name == other.name && dataType == other.dataType && readOnly == other.readOnly && unit == other.unit &&
+            minValue == other.minValue && maxValue == other.maxValue && precision == other.precision && enumValues == other.enumValues;
+    }
+
+    bool operator!=(const ParameterDescriptor& other) const {
+        return !(*this == other);
+    }
+
+private:
+    static InternCache<ParameterDescriptor>& GetCache() {
+        static InternCache<ParameterDescriptor>* cache = new InternCache<ParameterDescriptor>(); // Never destroyed, see InternCache
+        return *cache;
+    }
+
+    size_t Hash() const {
+        // The name, type and unit tell most descriptors apart. Equal descriptors always hash equal.
+        uint32_t hash = VirgilHash(unit, static_cast<uint32_t>(name.Hash()) * 16777619u ^ static_cast<uint32_t>(dataType) << 1 ^ readOnly);
+        return static_cast<size_t>(hash) ^ std::hash<const void*>{}(enumValues.get());
+    }
+};
+
+/**
+ * @brief The parameters of one channel, with shared metadata and packed live values.
+ * 
+ * Parameter keeps metadata and value together, so updating a meter such as audioLevel touches
+ * cold data too. ChannelParameters splits them:
+ * - The names and ParameterDescriptors of the channel form a layout, which is interned. Channels with
+ *   identical parameters share one layout, and changing a descriptor copies the layout (copy-on-write)
+ * - The values are a dense array of 4-byte slots, one per parameter, owned by the channel.
+ *   Applying a status update writes one slot
+ * 
+ * Slots hold int, float and bool values directly, and the index of the current value for enums.
+ * String values are kept in a separate array that the slot indexes.
+ * 
+ * Parameters are addressed by position. Use IndexOf() once to find a parameter, then read and write by index.
+ * 
+ * @note Not thread-safe. The shared layouts and descriptors are immutable, so different channels can be used on different threads
+ * 
+ * @example
+ * ```cpp
+ * ChannelParameters channel(infoResponse.parameters);
+ * size_t level = *channel.IndexOf(KnownParameter::audioLevel);
+ * channel.SetFloat(level, -12.5f); // Touches 4 bytes
+ * ```
+ */
+class ChannelParameters {
+public:
+    ChannelParameters() = default;
+
+    /// @brief Constructs the store from a list of parameters, e.g. InfoResponse::parameters.
+    explicit ChannelParameters(const ParameterList& params) {
+        Assign(params);
+    }
+
+    /// @brief Replaces all parameters with the given list.
+    void Assign(const ParameterList& params) {
+        Layout newLayout;
+        newLayout.names.reserve(params.size());
+        newLayout.descriptors.reserve(params.size());
+        values.clear();
+        strings.clear();
+        for (const Parameter& param : params) {
+            newLayout.names.push_back(param.name);
+            newLayout.descriptors.push_back(ParameterDescriptor::Intern(ParameterDescriptor(param)));
+            values.push_back(MakeSlot(param));
+        }
+        layout = InternLayout(std::move(newLayout));
+    }
+
+    /// @brief Adds a parameter, or replaces the one with the same name.
+    /// If only the value differs, only the value slot is written. Otherwise the layout is copied first.
+    void Update(const Parameter& param) {
+        std::optional<size_t> index = IndexOf(param.name);
+        std::shared_ptr<const ParameterDescriptor> descriptor = ParameterDescriptor::Intern(ParameterDescriptor(param));
+        if(index && layout->descriptors[*index] == descriptor) {
+            if(param.dataType == ParameterType::string)
+                strings[values[*index].index] = param.GetString();
+            else
+                values[*index] = MakeSlot(param);
+            return;
+        }
+        Layout newLayout = layout ? *layout : Layout{};
+        if(index) {
+            newLayout.descriptors[*index] = descriptor;
+            bool wasString = layout->descriptors[*index]->dataType == ParameterType::string;
+            if(wasString && param.dataType == ParameterType::string)
+                strings[values[*index].index] = param.GetString();
+            else {
+                // A parameter that changes type gives up its string slot, or needs one it did not have before
+                if(wasString)
+                    ReleaseString(*index);
+                values[*index] = MakeSlot(param);
+            }
+        }
+        else {
+            newLayout.names.push_back(param.name);
+            newLayout.descriptors.push_back(descriptor);
+            values.push_back(MakeSlot(param));
+        }
+        layout = InternLayout(std::move(newLayout));
+    }
+
+    /// @brief Gets the number of parameters.
+    size_t Size() const {
+        return values.size();
+    }
+
+    /// @brief Finds the position of a parameter. Interned names compare by symbol, so this is usually an integer compare per parameter.
+    std::optional<size_t> IndexOf(ParameterName name) const {
+        if(!layout)
+            return std::nullopt;
+        for (size_t i = 0; i < layout->names.size(); ++i)
+            if(layout->names[i] == name)
+                return i;
+        return std::nullopt;
+    }
+
+    /// @brief Gets the shared descriptor of the parameter at index.
+    const ParameterDescriptor& GetDescriptor(size_t index) const {
+        return *layout->descriptors.at(index);
+    }
+
+    /// @brief Checks if two channels share their layout, i.e. have identical parameter metadata.
+    bool SharesLayoutWith(const ChannelParameters& other) const {
+        return layout == other.layout;
+    }
+
+    // Typed value access. Each throws std::invalid_argument if the parameter at index has a different dataType.
+
+    int GetInt(size_t index) const { return Slot(index, ParameterType::integer).i; }
+    float GetFloat(size_t index) const { return Slot(index, ParameterType::floating).f; }
+    bool GetBool(size_t index) const { return Slot(index, ParameterType::boolean).b; }
+    const std::string& GetString(size_t index) const { return strings[Slot(index, ParameterType::string).index]; }
+
+    /// @brief Gets the current value of an enum parameter.
+    const std::string& GetEnumValue(size_t index) const {
+        const Value& slot = Slot(index, ParameterType::enumeration);
+        return (*layout->descriptors[index]->enumValues)[slot.index];
+    }
+
+    void SetInt(size_t index, int value) { MutableSlot(index, ParameterType::integer).i = value; }
+    void SetFloat(size_t index, float value) { MutableSlot(index, ParameterType::floating).f = value; }
+    void SetBool(size_t index, bool value) { MutableSlot(index, ParameterType::boolean).b = value; }
+    void SetString(size_t index, std::string_view value) { strings[MutableSlot(index, ParameterType::string).index].assign(value); }
+
+    /// @brief Selects the value of an enum parameter by name.
+    /// @throws std::invalid_argument if value is not one of the enum's values
+    void SetEnumValue(size_t index, std::string_view value) {
+        Value& slot = MutableSlot(index, ParameterType::enumeration);
+        VirgilEnum selected(layout->descriptors[index]->enumValues, 0);
+        if(!selected.SetValue(value))
+            VirgilThrowInvalidArgument("Enum parameter '" + layout->names[index].to_string() + "' has no value '" + std::string(value) + "'");
+        slot.index = selected.GetIndex();
+    }
+
+    /// @brief Rebuilds the full Parameter at index, e.g. to send it in an InfoResponse.
+    Parameter ToParameter(size_t index) const {
+        const ParameterDescriptor& descriptor = GetDescriptor(index);
+        const ParameterName& name = descriptor.name;
+        const Value& slot = values[index];
+        switch(descriptor.dataType) {
+            case ParameterType::string:
+                return Parameter(name, strings[slot.index], descriptor.readOnly);
+            case ParameterType::enumeration:
+                return Parameter(name, VirgilEnum(descriptor.enumValues, static_cast<uint16_t>(slot.index)), descriptor.readOnly);
+            case ParameterType::boolean:
+                return Parameter(name, slot.b, descriptor.readOnly);
+            case ParameterType::integer:
+                return Parameter(name, slot.i, descriptor.readOnly, descriptor.unit, 
+                    Constraint<int>(descriptor.minValue), Constraint<int>(descriptor.maxValue), Constraint<int>(descriptor.precision));
+            case ParameterType::floating:
+                return Parameter(name, slot.f, descriptor.readOnly, descriptor.unit, 
+                    Constraint<float>(descriptor.minValue), Constraint<float>(descriptor.maxValue), Constraint<float>(descriptor.precision));
+        }
+        VirgilThrowInvalidArgument("Parameter '" + name.to_string() + "' has an unknown dataType");
+    }
+
+private:
+    // One live value. Which member is used is given by the descriptor's dataType.
+    union Value {
+        int i;
+        float f;
+        bool b;
+        uint32_t index; // Enum value index, or position in strings for string parameters
+    };
+
+    // The metadata of a channel, shared by every channel with identical parameters.
+    struct Layout {
+        std::vector<ParameterName> names; // Copied out of the descriptors so lookups scan one dense array
+        std::vector<std::shared_ptr<const ParameterDescriptor>> descriptors;
+    };
+
+    std::shared_ptr<const Layout> layout;
+    std::vector<Value> values;
+    std::vector<std::string> strings;
+
+    static InternCache<Layout>& GetLayoutCache() {
+        static InternCache<Layout>* cache = new InternCache<Layout>(); // Never destroyed, see InternCache
+        return *cache;
+    }
+
+    // Descriptors are interned, so layouts are compared and hashed by descriptor pointer.
+    // A layout is freed with the last channel that uses it.
+    static std::shared_ptr<const Layout> InternLayout(Layout&& newLayout) {
+        size_t hash = newLayout.descriptors.size();
+        for (const auto& descriptor : newLayout.descriptors)
+            hash = hash * 31 + std::hash<const void*>{}(descriptor.get());
+        return GetLayoutCache().Intern(hash, 
+            [&](const Layout& cached) { return cached.descriptors == newLayout.descriptors; }, 
+            [&]() { return std::move(newLayout); });
+    }
+
+    // Builds the value slot of a parameter, storing string values in strings.
+    Value MakeSlot(const Parameter& param) {
+        Value slot;
+        slot.index = 0;
+        switch(param.dataType) {
+            case ParameterType::string:
+                slot.index = static_cast<uint32_t>(strings.size());
+                strings.push_back(param.GetString());
+                break;
+            case ParameterType::enumeration:
+                slot.index = param.GetEnum().GetIndex();
+                break;
+            case ParameterType::boolean:
+                slot.b = param.GetBool();
+                break;
+            case ParameterType::integer:
+                slot.i = param.GetInt();
+                break;
+            case ParameterType::floating:
+                slot.f = param.GetFloat();
+                break;
+        }
+        return slot;
+    }
+
+    // Frees the string of the string parameter at index, before it changes type.
+    // The last string moves into the freed position, so strings never has unused entries.
+    void ReleaseString(size_t index) {
+        uint32_t freed = values[index].index;
+        uint32_t last = static_cast<uint32_t>(strings.size() - 1);
+        if(freed != last) {
+            strings[freed] = std::move(strings[last]);
+            for (size_t i = 0; i < values.size(); ++i)
+                if(i != index && layout->descriptors[i]->dataType == ParameterType::string && values[i].index == last)
+                    values[i].index = freed;
+        }
+        strings.pop_back();
+    }
+
+    const Value& Slot(size_t index, ParameterType type) const {
+        const ParameterDescriptor& descriptor = GetDescriptor(index);
+        if(descriptor.dataType != type)
+            VirgilThrowInvalidArgument("Parameter '" + descriptor.name.to_string() + "' has dataType '" + 
+                std::string(ParameterTypeName(descriptor.dataType)) + "', not '" + std::string(ParameterTypeName(type)) + "'");
+        return values[index];
+    }
+
+    Value& MutableSlot(size_t index, ParameterType type) {
+        return const_cast<Value&>(Slot(index, type));
+    }
+
+    template <class T>
+    static std::optional<T> Constraint(const std::optional<std::variant<int,float>>& constraint) {
+        if(!constraint)
+            return std::nullopt;
+        return std::get<T>(*constraint);
+    }
+};
+
+/**
+ * @brief A struct representing linked channel information for the mandatory linkedChannels parameter.
+ * 
+ * LinkedChannelInfo describes a connection between the current channel and a channel on another
+ * device in the Virgil audio network. This information is stored in the mandatory "linkedChannels"
+ * parameter and represents the actual audio flow established via Dante networking.
+ * 
+ * The structure varies based on channel type:
+ * 
+ * **For TX/RX Channels** (audio flow):
+ * ```json
+ * {
+ *   "deviceName": "ConnectedDeviceName",
+ *   "channelIndex": 0,
+ *   "channelType": 1
+ * }
+ * ```
+ * 
+ * **For AUX Channels** (device control):
+ * ```json
+ * {
+ *   "deviceName": "ConnectedDeviceName"
+ *   // No channelIndex/channelType - AUX links to device, not specific channel
+ * }
+ * ```
+ * 
+ * Protocol Requirements:
+ * - linkedChannels array starts empty and is populated as connections are made
+ * - TX channels can link to multiple RX channels (one-to-many audio distribution)
+ * - RX channels typically link to one TX channel (audio source)
+ * - AUX channels link to devices for control purposes
+ * - If channels are subscribed in Dante, they must be linked in Virgil
+ * 
+ * This information enables:
+ * - Audio routing visualization and management
+ * - Automatic parameter subscription management  
+ * - Network topology discovery and validation
+ * - Conflict detection and resolution
+ * 
+ * @see Virgil Protocol 2.3.0 - "Parameters" section for linkedChannels specification
+ * @see ChannelID for channel identification details
+ */
+struct LinkedChannelInfo {
+    DeviceName deviceName; // std::string, or a FixedString with VIRGIL_STATIC_CAPACITY
+    ChannelID channel;
+
+    // Default constructor. Will be considered invalid until properly initialized.
+    LinkedChannelInfo() = default;
+
+    // Constructor with device name and channel
+    // @throws std::invalid_argument if devName is empty, or too long for DeviceName
+    LinkedChannelInfo(std::string_view devName, const ChannelID& chan) : deviceName(devName), channel(chan) {
+        if(devName.empty())
+            VirgilThrowInvalidArgument("LinkedChannelInfo device name cannot be empty. Channel info: type=" + 
+                std::to_string(static_cast<int>(chan.channelType)) + ", index=" + std::to_string(chan.channelIndex));
+    }
+
+    // Constructor from JSON
+    // @throws VirgilDecodeException if deviceName is missing or empty, or the channel fields are invalid
+    LinkedChannelInfo(const nlohmann::json& j) : LinkedChannelInfo(TryFromJSON(j).Value()) {}
+
+    /// @brief Same as the JSON constructor, but reports failures instead of throwing.
+    static VirgilResult<LinkedChannelInfo> TryFromJSON(const nlohmann::json& j) {
+        auto nameField = j.find("deviceName");
+        if(nameField == j.end())
+            return VirgilDecodeError::MissingField("LinkedChannelInfo", VirgilKey::deviceName);
+        if(!nameField->is_string())
+            return VirgilDecodeError::WrongType("LinkedChannelInfo", VirgilKey::deviceName, "a string", nameField->type_name());
+        const std::string& name = nameField->get_ref<const std::string&>();
+        if(name.empty())
+            return VirgilDecodeError::InvalidValue("LinkedChannelInfo", VirgilKey::deviceName, {}, "cannot be empty");
+        if(!DeviceNameFits(name))
+            return VirgilDecodeError::InvalidValue("LinkedChannelInfo", VirgilKey::deviceName, name, "is longer than VIRGIL_MAX_DEVICE_NAME");
+
+        VirgilResult<ChannelID> chan = ChannelID::TryFromJSON(j);
+        if(!chan)
+            return chan.Error();
+        LinkedChannelInfo info;
+        info.deviceName = name;
+        info.channel = *chan;
+        return info;
+    }
+
+    nlohmann::json to_json() const {
+        if(!*this)
+            VirgilThrowInvalidArgument("Cannot convert invalid LinkedChannelInfo to JSON. DeviceName='" + std::string(deviceName) + 
+                "', channelType=" + std::to_string(static_cast<int>(channel.channelType)) + 
+                ", channelIndex=" + std::to_string(channel.channelIndex));
+        nlohmann::json j;
+        j["deviceName"] = std::string_view(deviceName);
+        channel.AppendJson(j);
+        return j;
+    }
+
+    // Appends the LinkedChannelInfo as a compact JSON object. Writes the same fields as to_json().
+    void serialize(JsonWriter& writer) const {
+        if(!*this)
+            VirgilThrowInvalidArgument("Cannot convert invalid LinkedChannelInfo to JSON. DeviceName='" + std::string(deviceName) + 
+                "', channelType=" + std::to_string(static_cast<int>(channel.channelType)) + 
+                ", channelIndex=" + std::to_string(channel.channelIndex));
+        writer.BeginObject();
+        writer.Key("deviceName");
+        writer.String(deviceName);
+        channel.AppendJson(writer);
+        writer.EndObject();
+    }
+
+    operator bool() const {
+        return !deviceName.empty();
+    }
+};
+
+/**
+ * @brief The decoded fields of a single Virgil message, before it is turned into a Message subclass.
+ * 
+ * Decoders fill this record in one pass over their input, setting the VirgilKeyBit() of every
+ * message-level key they find in `present`, and then pass it to the constructor of the matching
+ * Message subclass. Those constructors validate required fields against `present`, so validation
+ * is the same no matter how the message was decoded.
+ * 
+ * For the message types that carry parameters (see CarriesParameters()), object-valued keys that are not
+ * VirgilKeys are decoded into `parameters`. They are skipped for every other type. The entries of the
+ * linkedChannels array are decoded into `linkedChannels`.
+ * 
+ * @see MessageDecoder for the SAX decoder that fills this directly from JSON text
+ */
+struct MessageFields {
+    uint32_t present = 0; // VirgilKeyBit() of every message-level key that was found
+    MessageType messageType = MessageType::channelLink; // Only meaningful if Has(VirgilKey::messageType)
+    MessageID messageID;
+    MessageID responseID;
+    uint64_t channelIndex = 0;
+    uint64_t channelType = 0;
+    uint64_t sendingChannelIndex = 0;
+    uint64_t sendingChannelType = 0;
+    std::string errorValue;
+    std::string errorString;
+    LinkedChannelList linkedChannels;
+    ParameterList parameters;
+
+    /// @brief Reads the fields of a parsed message object.
+    /// Walks the object once, classifying each key with ParseVirgilKey(), instead of looking every field up by name.
+    /// Required fields are not checked here; the Message constructors do that with Require().
+    /// @throws VirgilDecodeException if j is not an object or a known field has the wrong type
+    static MessageFields FromJSON(const nlohmann::json& j);
+
+    /// @brief Same as FromJSON(), but reports failures instead of throwing.
+    /// @return false, with error filled in, if j is not an object or a field is invalid
+    static bool Read(const nlohmann::json& j, MessageFields& fields, VirgilDecodeError& error);
+
+    // Checks if a key was present in the decoded message.
+    bool Has(VirgilKey key) const {
+        return (present & VirgilKeyBit(key)) != 0;
+    }
+
+    /// @brief Validates that a required field was present.
+    /// @param key The required field.
+    /// @param owner Name of the message being constructed, used in the error message.
+    /// @throws VirgilDecodeException if the field is missing
+    void Require(VirgilKey key, const char* owner) const {
+        VirgilDecodeError error;
+        if(!Check(key, owner, error))
+            VirgilThrowDecodeError(error);
+    }
+
+    /// @brief Validates that the decoded message has the expected messageType.
+    /// @param type The messageType the caller can construct.
+    /// @param owner Name of the message being constructed, used in the error message.
+    /// @throws VirgilDecodeException if messageType is missing or different
+    void RequireType(MessageType type, const char* owner) const {
+        VirgilDecodeError error;
+        if(!CheckType(type, owner, error))
+            VirgilThrowDecodeError(error);
+    }
+
+    // Non-throwing versions of Require() and RequireType(). They return false and fill in error on failure.
+
+    bool Check(VirgilKey key, const char* owner, VirgilDecodeError& error) const {
+        if(Has(key))
+            return true;
+        error = VirgilDecodeError::MissingField(owner, key);
+        return false;
+    }
+
+    bool CheckType(MessageType type, const char* owner, VirgilDecodeError& error) const {
+        if(!Check(VirgilKey::messageType, owner, error))
+            return false;
+        if(messageType == type)
+            return true;
+        error = VirgilDecodeError(VirgilErrorCode::wrongMessageType, owner, VirgilKey::messageType);
+        error.expected = MessageTypeName(type).data();
+        error.input = MessageTypeName(messageType);
+        return false;
+    }
+
+    /// @brief Builds the ChannelID stored in "channelIndex" and "channelType".
+    /// @throws VirgilDecodeException if either field is missing or the index is out of range
+    ChannelID GetChannel() const {
+        return MakeChannel(VirgilKey::channelIndex, channelIndex, VirgilKey::channelType, channelType, present);
+    }
+
+    /// @brief Builds the ChannelID stored in "sendingChannelIndex" and "sendingChannelType".
+    /// @throws VirgilDecodeException if either field is missing or the index is out of range
+    ChannelID GetSendingChannel() const {
+        return MakeChannel(VirgilKey::sendingChannelIndex, sendingChannelIndex, VirgilKey::sendingChannelType, sendingChannelType, present);
+    }
+
+    // Checks, without throwing, that GetChannel() and GetSendingChannel() would succeed.
+
+    bool CheckChannel(VirgilDecodeError& error) const {
+        return CheckChannel(VirgilKey::channelIndex, channelIndex, VirgilKey::channelType, channelType, present, error);
+    }
+
+    bool CheckSendingChannel(VirgilDecodeError& error) const {
+        return CheckChannel(VirgilKey::sendingChannelIndex, sendingChannelIndex, VirgilKey::sendingChannelType, sendingChannelType, present, error);
+    }
+
+    /// @brief Builds a ChannelID from raw decoded index and type values.
+    /// @param indexKey The key the index was read from, used in error messages.
+    /// @param typeKey The key the type was read from, used in error messages.
+    /// @param present Presence bitmask the keys are checked against.
+    /// @throws VirgilDecodeException if either field is missing or out of range
+    static ChannelID MakeChannel(VirgilKey indexKey, uint64_t index, VirgilKey typeKey, uint64_t type, uint32_t present) {
+        VirgilDecodeError error;
+        if(!CheckChannel(indexKey, index, typeKey, type, present, error))
+            VirgilThrowDecodeError(error);
+        return ChannelID(static_cast<int>(index), static_cast<LinkType>(type));
+    }
 
-#include "nlohmann/json.hpp" // nlohmann/json single header
-#include <cstdint>
+    /// @brief Checks, without throwing, that MakeChannel() would succeed.
+    static bool CheckChannel(VirgilKey indexKey, uint64_t index, VirgilKey typeKey, uint64_t type, uint32_t present, VirgilDecodeError& error) {
+        if(!(present & VirgilKeyBit(typeKey)))
+            error = VirgilDecodeError::MissingField("ChannelID", typeKey);
+        else if(!(present & VirgilKeyBit(indexKey)))
+            error = VirgilDecodeError::MissingField("ChannelID", indexKey);
+        else if(type > UINT8_MAX)
+            error = VirgilDecodeError::OutOfRange(typeKey, type, "between 0 and 255");
+        else if(index > UINT16_MAX)
+            error = VirgilDecodeError::OutOfRange(indexKey, index, "between 0 and 65535");
+        else
+            return true;
+        return false;
+    }
+};
 
-// Forward declarations
-struct MessageID;
-struct ChannelID;
-class Message;
-class ChannelLink;
+/**
+ * @brief Deleter for messages returned by the pooled factories (Message::FromJSONPooled, MessageDecoder::DecodePooled).
+ * 
+ * Messages from a MessagePool are destroyed and their memory returned to the pool of their type.
+ * A default-constructed deleter uses plain `delete`, so a MessagePtr can also own a message created with `new`.
+ */
+struct MessageDeleter {
+    void (*release)(Message* message) = nullptr; // Destroys the message and frees its memory, or nullptr to use delete
+
+    void operator()(Message* message) const;
+};
 
+/// @brief Owning pointer to a message, which may come from a MessagePool.
+using MessagePtr = std::unique_ptr<Message, MessageDeleter>;
 
 /**
  * @brief Base abstract class for all Virgil Protocol 2.3.0 messages.
@@ -49,8 +3593,26 @@ class Message {
         std::optional<MessageID> responseID; // The ID of the message this is responding to. This is not required for all messages.
         bool isOutbound; // True if message is outbound, false if inbound
         virtual nlohmann::json to_json() const = 0; // Convert message to JSON for sending
+        virtual void serialize(JsonWriter& writer) const = 0; // Append message as compact JSON text for sending. Produces the same fields as to_json()
         virtual ~Message() = default; // Virtual destructor for proper cleanup
 
+        /// @brief Appends the message as compact JSON text to a caller-owned buffer.
+        /// This is the allocation-free alternative to `to_json().dump()`. Reuse the same buffer for
+        /// every message (clearing it in between) so it stops growing once it fits the largest message.
+        /// @param buffer The buffer to append to. Existing contents are kept.
+        /// @throws std::invalid_argument under the same conditions as to_json()
+        void append_to(std::string& buffer) const {
+            size_t start = buffer.size();
+            JsonWriter writer(buffer);
+            VIRGIL_TRY {
+                serialize(writer);
+            } VIRGIL_CATCH_ALL {
+                // Do not leave a partial message behind
+                buffer.resize(start);
+                VIRGIL_RETHROW;
+            }
+        }
+
         /**
          * @brief Factory method to construct the appropriate Message subclass from JSON.
          * 
@@ -58,13 +3620,15 @@ class Message {
          * corresponding Message subclass instance. This is the primary method for
          * deserializing incoming Virgil protocol messages.
          *
+         * The messageType string is resolved with ParseMessageType() (one perfect hash, no string copy)
+         * and the constructor is looked up in MessageFactories, so dispatch costs one indirect call.
          * 
          * @param j The JSON object containing the message data. Must include "messageType" field.
          * @param outbound True if the message is outbound (being sent), false if inbound (received).
          * @return A pointer to a newly allocated Message subclass instance. 
-         * @throws std::invalid_argument if messageType is missing or unknown
+         * @throws std::invalid_argument if messageType is missing, unknown, or not yet implemented
          * @throws If constructor for the detected messageType fails
-         * @note Caller is responsible for deleting the returned pointer
+         * @note Caller is responsible for deleting the returned pointer. FromJSONPooled() returns an owning pointer instead
          * @note Additional message types will be added as they are implemented
          * @note This is meant to be called on a single message found in the Messages array in a virgil message
          * 
@@ -76,26 +3640,49 @@ class Message {
          * delete msg; // Don't forget to cleanup
          * ```
          */
-        static Message* FromJSON(const nlohmann::json& j, bool outbound)
-        {
-            if(!j.contains("messageType"))
-                throw std::invalid_argument("Message JSON must contain 'messageType' field. Received JSON keys: " + 
-                    [&j]() {
-                        std::string keys = "";
-                        for (auto it = j.begin(); it != j.end(); ++it) {
-                            if (!keys.empty()) keys += ", ";
-                            keys += "'" + it.key() + "'";
-                        }
-                        return keys.empty() ? "(empty)" : keys;
-                    }());
-            
-            std::string messageType = j.at("messageType").get<std::string>();
-            if(messageType == "channelLink")
-                return new ChannelLink(j, outbound);
-            else if(messageType == "channelUnlink")
-                return new ChannelUnlink(j, outbound);
-            else
-                throw std::invalid_argument("Unknown messageType value: '" + messageType + "'. Supported types: 'channelLink', 'channelUnlink'");
+        static Message* FromJSON(const nlohmann::json& j, bool outbound);
+
+        /**
+         * @brief Same as FromJSON(), but the message is allocated from the MessagePool of its type and returned owned.
+         * 
+         * Reusing pooled memory avoids a general-purpose heap allocation and free for every inbound
+         * message, and the returned pointer frees the message automatically.
+         * 
+         * @param j The JSON object containing the message data. Must include "messageType" field.
+         * @param outbound True if the message is outbound (being sent), false if inbound (received).
+         * @return The constructed message
+         * @throws std::invalid_argument under the same conditions as FromJSON()
+         */
+        static MessagePtr FromJSONPooled(const nlohmann::json& j, bool outbound);
+
+        /// @brief Finds the MessageFactories entry for the messageType of a JSON message.
+        /// @throws std::invalid_argument if messageType is missing, unknown, or not yet implemented
+        static const MessageFactory& FactoryFor(const nlohmann::json& j);
+
+        /// @brief Finds the MessageFactories entry for the messageType of decoded fields, without throwing.
+        /// @return The factory, or nullptr with error filled in if messageType is missing or not yet implemented
+        static const MessageFactory* FindFactory(const MessageFields& fields, VirgilDecodeError& error);
+
+        /**
+         * @brief Same as FromJSONPooled(), but returns the error instead of throwing it.
+         * 
+         * Use this on untrusted input where malformed messages are expected, so rejecting one does not
+         * cost an exception. Only allocation failures are still thrown.
+         * 
+         * @param j The JSON object containing the message data. Must include "messageType" field.
+         * @param outbound True if the message is outbound (being sent), false if inbound (received).
+         * @return The constructed message, or the reason it could not be constructed
+         */
+        static VirgilResult<MessagePtr> TryFromJSON(const nlohmann::json& j, bool outbound);
+
+    protected:
+        // Begins the message object and writes messageType and messageID. Generates a new messageID if selfID is empty.
+        void WriteHeader(JsonWriter& writer, MessageType type) const {
+            writer.BeginObject();
+            writer.Key("messageType");
+            writer.String(MessageTypeName(type));
+            writer.Key("messageID");
+            writer.String((selfID ? selfID : MessageID::GenerateNew()).to_array());
         }
 };
 
@@ -120,7 +3707,7 @@ class Message {
  * @see Virgil Protocol 2.3.0 - "Linking Channels" section
  * @see ChannelUnlink for the corresponding unlink operation
  */
-class ChannelLink : public Message {
+class ChannelLink final : public Message {
 public:
 
     ChannelID sendingChannel;
@@ -132,6 +3719,8 @@ public:
      * Parses a JSON message containing channelLink data and initializes the object.
      * Validates required fields and constructs appropriate ChannelID objects for
      * sending and receiving channels.
+     * The object is read in one pass by MessageFields::FromJSON(), and then validated
+     * by the MessageFields constructor.
      * 
      * Required JSON fields:
      * - "messageType": must be "channelLink"
@@ -149,43 +3738,43 @@ public:
      * @throws std::invalid_argument if required fields are missing or messageType is incorrect
      * @note For AUX channels, receivingChannel will be std::nullopt as they link to devices
      */
-    ChannelLink(const nlohmann::json& j, bool outbound) {
-        // Double checks that this is a ChannelLink message
-        if(!j.contains("messageType"))
-            throw std::invalid_argument("ChannelLink JSON must contain 'messageType' field");
-        
-        std::string msgType = j.at("messageType").get<std::string>();
-        if(msgType != "channelLink")
-            throw std::invalid_argument("ChannelLink JSON must have messageType='channelLink', but received messageType='" + msgType + "'");
-        
-        // Makes sure messageID is present
-        if(!j.contains("messageID"))
-            throw std::invalid_argument("ChannelLink JSON must contain 'messageID' field");
-        // Reads messageID and constructs from string
-        selfID = MessageID(j.at("messageID").get<std::string>());
-
-        // Reads responseID if present. This is not required for ChannelLink messages per Virgil protocol.
-        if(j.contains("responseID"))
-            responseID = MessageID(j.at("responseID").get<std::string>());
-        else
-            responseID = MessageID(); // Empty ID if not present
+    ChannelLink(const nlohmann::json& j, bool outbound) : ChannelLink(MessageFields::FromJSON(j), outbound) {}
 
-        // Sets outbound status. This must be provided by the caller since the bare message does not include this information.
+    /**
+     * @brief Construct a ChannelLink from decoded message fields.
+     * 
+     * Validates the same required fields as the JSON constructor.
+     * 
+     * @param fields The decoded message. messageType must be channelLink.
+     * @param outbound True if the message is outbound (being sent), false if inbound (received).
+     * @throws std::invalid_argument if required fields are missing or messageType is incorrect
+     * @note For AUX channels, receivingChannel will be std::nullopt as they link to devices
+     */
+    ChannelLink(const MessageFields& fields, bool outbound) {
+        VirgilDecodeError error;
+        if(!Check(fields, error))
+            VirgilThrowDecodeError(error);
+        selfID = fields.messageID;
+        if(fields.Has(VirgilKey::responseID))
+            responseID = fields.responseID;
         isOutbound = outbound;
 
-        // NOTE: sendingChannel and receivingChannel will not be flipped based on outbound status.
-        // This is because the message is from the perspective of the sender, and this class just represents the message as-is.
-
-        // Reads sending channel information with custom field names as per Virgil protocol specification
-        // Uses "sendingChannelIndex" and "sendingChannelType" to distinguish from receiving channel fields
-        sendingChannel = ChannelID(j, "sendingChannelIndex", "sendingChannelType");
-        
-        // Reads receiving channel information with standard field names ("channelIndex", "channelType")
-        // For AUX channels, receiving channel must be omitted as they link to devices rather than channels
-        if(j.contains("channelIndex") || j.contains("channelType"))
-            receivingChannel = ChannelID(j);
+        sendingChannel = fields.GetSendingChannel();
+        // Receiving channel is omitted for AUX channels
+        if(fields.Has(VirgilKey::channelIndex) || fields.Has(VirgilKey::channelType))
+            receivingChannel = fields.GetChannel();
         else
-            receivingChannel = std::nullopt; // AUX channels can omit receiving channel
+            receivingChannel = std::nullopt;
+    }
+
+    /// @brief Checks, without throwing, that decoded fields hold a valid ChannelLink.
+    /// @return false, with error filled in, if the fields constructor would throw
+    static bool Check(const MessageFields& fields, VirgilDecodeError& error) {
+        if(!fields.CheckType(MessageType::channelLink, "ChannelLink", error) || !fields.Check(VirgilKey::messageID, "ChannelLink", error) || 
+            !fields.CheckSendingChannel(error))
+            return false;
+        // Receiving channel is omitted for AUX channels
+        return !(fields.Has(VirgilKey::channelIndex) || fields.Has(VirgilKey::channelType)) || fields.CheckChannel(error);
     }
 
     /// TODO: recvChan should not be optional. SendingChannel should instead be optional for aux channels. 
@@ -259,7 +3848,7 @@ public:
         // Validate Virgil protocol rule: only AUX channels can omit receiving channel
         // TX/RX channels must specify both sending and receiving channels for audio flow
         if(!sendingChannel.IsAux() && !receivingChannel)
-            throw std::invalid_argument("Non-AUX sendingChannel (type=" + std::to_string(static_cast<int>(sendingChannel.channelType)) + 
+            VirgilThrowInvalidArgument("Non-AUX sendingChannel (type=" + std::to_string(static_cast<int>(sendingChannel.channelType)) + 
                 ", index=" + std::to_string(sendingChannel.channelIndex) + ") must have a receivingChannel. Only AUX channels can omit receivingChannel.");
         
         // Add receiving channel info with standard field names (channelIndex, channelType) if present
@@ -269,6 +3858,29 @@ public:
         return j;
     }
 
+    /**
+     * @brief Appends the ChannelLink as compact JSON text. Writes the same fields as to_json().
+     * 
+     * @param writer The writer to append to.
+     * @throws std::invalid_argument if receivingChannel is missing when sendingChannel is not AUX
+     * @note Automatically generates a new messageID if selfID is empty
+     */
+    void serialize(JsonWriter& writer) const override {
+        // Validated before writing anything so a failed message leaves no partial output
+        if(!sendingChannel.IsAux() && !receivingChannel)
+            VirgilThrowInvalidArgument("Non-AUX sendingChannel (type=" + std::to_string(static_cast<int>(sendingChannel.channelType)) + 
+                ", index=" + std::to_string(sendingChannel.channelIndex) + ") must have a receivingChannel. Only AUX channels can omit receivingChannel.");
+        WriteHeader(writer, MessageType::channelLink);
+        if(responseID) {
+            writer.Key("responseID");
+            writer.String(responseID->to_array());
+        }
+        sendingChannel.AppendJson(writer, "sendingChannelIndex", "sendingChannelType");
+        if(receivingChannel)
+            receivingChannel->AppendJson(writer);
+        writer.EndObject();
+    }
+
 
 };
 
@@ -292,7 +3904,7 @@ public:
  * @see Virgil Protocol 2.3.0 - "Linking Channels" section
  * @see ChannelLink for the corresponding link operation
  */
-class ChannelUnlink : public Message {
+class ChannelUnlink final : public Message {
 public:
 
     ChannelID sendingChannel;
@@ -303,42 +3915,38 @@ public:
      * @param j The JSON object to initialize from.
      * @param outbound True if the message is outbound, false if inbound.
      */
-    ChannelUnlink(const nlohmann::json& j, bool outbound) {
-        // Double checks that this is a ChannelUnlink message
-        if(!j.contains("messageType"))
-            throw std::invalid_argument("ChannelUnlink JSON must contain 'messageType' field");
-        
-        std::string msgType = j.at("messageType").get<std::string>();
-        if(msgType != "channelUnlink")
-            throw std::invalid_argument("ChannelUnlink JSON must have messageType='channelUnlink', but received messageType='" + msgType + "'");
-        
-        // Makes sure messageID is present
-        if(!j.contains("messageID"))
-            throw std::invalid_argument("ChannelUnlink JSON must contain 'messageID' field");
-        // Reads messageID and constructs from string
-        selfID = MessageID(j.at("messageID").get<std::string>());
-
-        // Reads responseID if present. This is not required for ChannelUnlink messages.
-        if(j.contains("responseID"))
-            responseID = MessageID(j.at("responseID").get<std::string>());
-        else
-            responseID = MessageID(); // Empty ID if not present
+    ChannelUnlink(const nlohmann::json& j, bool outbound) : ChannelUnlink(MessageFields::FromJSON(j), outbound) {}
 
-        // Sets outbound status. This must be provided by the caller since the bare message does not include this information.
+    /**
+     * @brief Construct a ChannelUnlink from decoded message fields.
+     * @param fields The decoded message. messageType must be channelUnlink.
+     * @param outbound True if the message is outbound, false if inbound.
+     */
+    ChannelUnlink(const MessageFields& fields, bool outbound) {
+        VirgilDecodeError error;
+        if(!Check(fields, error))
+            VirgilThrowDecodeError(error);
+        selfID = fields.messageID;
+        if(fields.Has(VirgilKey::responseID))
+            responseID = fields.responseID;
         isOutbound = outbound;
 
-        // Please note that sendingChannel and receivingChannel will not be flipped based on outbound status.
-        // This is because the message is from the perspective of the sender, and this class just represents the message as-is.
-
-        // Reads sending channels with custom field names.
-        sendingChannel = ChannelID(j, "sendingChannelIndex", "sendingChannelType");
-        // Reads receiving channels with default field names.
-        if(j.contains("channelIndex") || j.contains("channelType"))
-            receivingChannel = ChannelID(j);
+        sendingChannel = fields.GetSendingChannel();
+        if(fields.Has(VirgilKey::channelIndex) || fields.Has(VirgilKey::channelType))
+            receivingChannel = fields.GetChannel();
         else
             receivingChannel = std::nullopt;
     }
 
+    /// @brief Checks, without throwing, that decoded fields hold a valid ChannelUnlink.
+    /// @return false, with error filled in, if the fields constructor would throw
+    static bool Check(const MessageFields& fields, VirgilDecodeError& error) {
+        if(!fields.CheckType(MessageType::channelUnlink, "ChannelUnlink", error) || !fields.Check(VirgilKey::messageID, "ChannelUnlink", error) || 
+            !fields.CheckSendingChannel(error))
+            return false;
+        return !(fields.Has(VirgilKey::channelIndex) || fields.Has(VirgilKey::channelType)) || fields.CheckChannel(error);
+    }
+
     ChannelUnlink(MessageID msgId, bool outbound, ChannelID sendChan, std::optional<ChannelID> recvChan, std::optional<MessageID> respId) {
         sendingChannel = sendChan;
         receivingChannel = *recvChan;
@@ -360,7 +3968,7 @@ public:
         }
         sendingChannel.AppendJson(j, "sendingChannelIndex", "sendingChannelType");
         if(!sendingChannel.IsAux() && !receivingChannel)
-            throw std::invalid_argument("Non-AUX sendingChannel (type=" + std::to_string(static_cast<int>(sendingChannel.channelType)) + 
+            VirgilThrowInvalidArgument("Non-AUX sendingChannel (type=" + std::to_string(static_cast<int>(sendingChannel.channelType)) + 
                 ", index=" + std::to_string(sendingChannel.channelIndex) + ") must have a receivingChannel. Only AUX channels can omit receivingChannel.");
         if (receivingChannel) {
             receivingChannel->AppendJson(j);
@@ -370,6 +3978,23 @@ public:
         return j;
     }
 
+    /// Appends the ChannelUnlink as compact JSON text. Writes the same fields as to_json().
+    /// @throws std::invalid_argument if the receivingChannel is missing when sendingChannel is not aux.
+    void serialize(JsonWriter& writer) const override {
+        if(!sendingChannel.IsAux() && !receivingChannel)
+            VirgilThrowInvalidArgument("Non-AUX sendingChannel (type=" + std::to_string(static_cast<int>(sendingChannel.channelType)) + 
+                ", index=" + std::to_string(sendingChannel.channelIndex) + ") must have a receivingChannel. Only AUX channels can omit receivingChannel.");
+        WriteHeader(writer, MessageType::channelUnlink);
+        sendingChannel.AppendJson(writer, "sendingChannelIndex", "sendingChannelType");
+        if(receivingChannel)
+            receivingChannel->AppendJson(writer);
+        if(responseID) {
+            writer.Key("responseID");
+            writer.String(responseID->to_array());
+        }
+        writer.EndObject();
+    }
+
 
 };
 
@@ -393,31 +4018,27 @@ public:
  * @see Virgil Protocol 2.3.0 - "Communication Session Management" section
  * @note This message type is crucial for proper session management and avoiding timeouts
  */
-class EndResponse : public Message {
+class EndResponse final : public Message {
 public:
     // Constructs an EndResponse from a JSON object.
-    EndResponse(const nlohmann::json& j, bool outbound) {
-        // Double checks that this is an EndResponse message
-        if(!j.contains("messageType"))
-            throw std::invalid_argument("EndResponse JSON must contain 'messageType' field");
-        
-        std::string msgType = j.at("messageType").get<std::string>();
-        if(msgType != "endResponse")
-            throw std::invalid_argument("EndResponse JSON must have messageType='endResponse', but received messageType='" + msgType + "'");
-        
-        // Makes sure messageID is present
-        if(!j.contains("messageID"))
-            throw std::invalid_argument("EndResponse JSON must contain 'messageID' field");
-        if(!j.contains("responseID"))
-            throw std::invalid_argument("EndResponse JSON must contain 'responseID' field");
-        // Reads messageID and constructs from string
-        selfID = MessageID(j.at("messageID").get<std::string>());
-        responseID = MessageID(j.at("responseID").get<std::string>());
-
-        // Sets outbound status. This must be provided by the caller since the bare message does not include this information.
+    EndResponse(const nlohmann::json& j, bool outbound) : EndResponse(MessageFields::FromJSON(j), outbound) {}
+
+    // Constructs an EndResponse from decoded message fields.
+    EndResponse(const MessageFields& fields, bool outbound) {
+        VirgilDecodeError error;
+        if(!Check(fields, error))
+            VirgilThrowDecodeError(error);
+        selfID = fields.messageID;
+        responseID = fields.responseID;
         isOutbound = outbound;
     }
 
+    // Checks decoded fields without throwing. Returns false and fills in error if the fields constructor would throw.
+    static bool Check(const MessageFields& fields, VirgilDecodeError& error) {
+        return fields.CheckType(MessageType::endResponse, "EndResponse", error) && fields.Check(VirgilKey::messageID, "EndResponse", error) && 
+            fields.Check(VirgilKey::responseID, "EndResponse", error);
+    }
+
     // Constructs an EndResponse with given parameters.
     EndResponse(MessageID msgId, bool outbound, MessageID respId) {
         responseID = respId;
@@ -427,6 +4048,8 @@ public:
 
     // Converts the EndResponse to a JSON object for sending.
     nlohmann::json to_json() const override {
+        if(!responseID)
+            VirgilThrowInvalidArgument("EndResponse must have a responseID to identify which request it ends");
         nlohmann::json j;
         j["messageType"] = "endResponse";
         if(selfID)
@@ -437,6 +4060,15 @@ public:
         j["responseID"] = responseID->to_string();
         return j;
     }
+    // Appends the EndResponse as compact JSON text. Writes the same fields as to_json().
+    void serialize(JsonWriter& writer) const override {
+        if(!responseID)
+            VirgilThrowInvalidArgument("EndResponse must have a responseID to identify which request it ends");
+        WriteHeader(writer, MessageType::endResponse);
+        writer.Key("responseID");
+        writer.String(responseID->to_array());
+        writer.EndObject();
+    }
 };
 
 /**
@@ -467,42 +4099,33 @@ public:
  * @see Virgil Protocol 2.3.0 - "Error Types" section
  * @note Always provide clear, user-friendly error messages in errorString
  */
-class ErrorResponse : public Message {
+class ErrorResponse final : public Message {
 public:
-    MessageID responseID; // The ID of the message this is responding to
     std::string errorValue; // The predefined error type
     std::string errorString; // Human-readable error message
 
     // Constructs an ErrorResponse from a JSON object.
-    ErrorResponse(const nlohmann::json& j, bool outbound) {
-        // Double checks that this is an ErrorResponse message
-        if(!j.contains("messageType"))
-            throw std::invalid_argument("ErrorResponse JSON must contain 'messageType' field");
-        
-        std::string msgType = j.at("messageType").get<std::string>();
-        if(msgType != "errorResponse")
-            throw std::invalid_argument("ErrorResponse JSON must have messageType='errorResponse', but received messageType='" + msgType + "'");
-        
-        // Makes sure required fields are present
-        if(!j.contains("messageID"))
-            throw std::invalid_argument("ErrorResponse JSON must contain 'messageID' field");
-        if(!j.contains("responseID"))
-            throw std::invalid_argument("ErrorResponse JSON must contain 'responseID' field");
-        if(!j.contains("errorValue"))
-            throw std::invalid_argument("ErrorResponse JSON must contain 'errorValue' field");
-        if(!j.contains("errorString"))
-            throw std::invalid_argument("ErrorResponse JSON must contain 'errorString' field");
-
-        // Reads messageID and constructs from string
-        selfID = MessageID(j.at("messageID").get<std::string>());
-        responseID = MessageID(j.at("responseID").get<std::string>());
-        // Reads errorValue and errorString
-        errorValue = j.at("errorValue").get<std::string>();
-        errorString = j.at("errorString").get<std::string>();
-        // Sets outbound status. This must be provided by the caller since the bare message does not include this information.
+    ErrorResponse(const nlohmann::json& j, bool outbound) : ErrorResponse(MessageFields::FromJSON(j), outbound) {}
+
+    // Constructs an ErrorResponse from decoded message fields.
+    ErrorResponse(const MessageFields& fields, bool outbound) {
+        VirgilDecodeError error;
+        if(!Check(fields, error))
+            VirgilThrowDecodeError(error);
+        selfID = fields.messageID;
+        responseID = fields.responseID;
+        errorValue = fields.errorValue;
+        errorString = fields.errorString;
         isOutbound = outbound;
     }
 
+    // Checks decoded fields without throwing. Returns false and fills in error if the fields constructor would throw.
+    static bool Check(const MessageFields& fields, VirgilDecodeError& error) {
+        return fields.CheckType(MessageType::errorResponse, "ErrorResponse", error) && fields.Check(VirgilKey::messageID, "ErrorResponse", error) && 
+            fields.Check(VirgilKey::responseID, "ErrorResponse", error) && fields.Check(VirgilKey::errorValue, "ErrorResponse", error) && 
+            fields.Check(VirgilKey::errorString, "ErrorResponse", error);
+    }
+
     // Constructs an ErrorResponse with given parameters.
     ErrorResponse(MessageID msgId, bool outbound, MessageID respId, const std::string& errorVal, const std::string& errorStr) {
         responseID = respId;
@@ -523,6 +4146,8 @@ public:
 
     // Converts the ErrorResponse to a JSON object for sending.
     nlohmann::json to_json() const override {
+        if(!responseID)
+            VirgilThrowInvalidArgument("ErrorResponse must have a responseID to identify which request failed");
         nlohmann::json j;
         j["messageType"] = "errorResponse";
         if(selfID)
@@ -530,11 +4155,25 @@ public:
         else {
             j["messageID"] = MessageID::GenerateNew().to_string();
         }
-        j["responseID"] = responseID.to_string();
+        j["responseID"] = responseID->to_string();
         j["errorValue"] = errorValue;
         j["errorString"] = errorString;
         return j;
     }
+
+    // Appends the ErrorResponse as compact JSON text. Writes the same fields as to_json().
+    void serialize(JsonWriter& writer) const override {
+        if(!responseID)
+            VirgilThrowInvalidArgument("ErrorResponse must have a responseID to identify which request failed");
+        WriteHeader(writer, MessageType::errorResponse);
+        writer.Key("responseID");
+        writer.String(responseID->to_array());
+        writer.Key("errorValue");
+        writer.String(errorValue);
+        writer.Key("errorString");
+        writer.String(errorString);
+        writer.EndObject();
+    }
 };
 
 /**
@@ -562,36 +4201,30 @@ public:
  * @see InfoResponse for the corresponding response message
  * @see DeviceInfoRequest for device-level information requests
  */
-class InfoRequest : public Message {
+class InfoRequest final : public Message {
 public:
     ChannelID channel; // The channel to request info about
     // Constructs an InfoRequest from a JSON object.
-    InfoRequest(const nlohmann::json& j, bool outbound) {
-        // Double checks that this is an InfoRequest message
-        if(!j.contains("messageType"))
-            throw std::invalid_argument("InfoRequest JSON must contain 'messageType' field");
-        
-        std::string msgType = j.at("messageType").get<std::string>();
-        if(msgType != "infoRequest")
-            throw std::invalid_argument("InfoRequest JSON must have messageType='infoRequest', but received messageType='" + msgType + "'");
-        
-        // Makes sure messageID is present
-        if(!j.contains("messageID"))
-            throw std::invalid_argument("InfoRequest JSON must contain 'messageID' field");
-
-        // Reads messageID and constructs from string
-        selfID = MessageID(j.at("messageID").get<std::string>());
-
-        channel = ChannelID(j);
-
-        // Reads responseID if present. This is not required for InfoRequest messages.
-        if(j.contains("responseID"))
-            responseID = MessageID(j.at("responseID").get<std::string>());
+    InfoRequest(const nlohmann::json& j, bool outbound) : InfoRequest(MessageFields::FromJSON(j), outbound) {}
 
-        // Sets outbound status. This must be provided by the caller since the bare message does not include this information.
+    // Constructs an InfoRequest from decoded message fields.
+    InfoRequest(const MessageFields& fields, bool outbound) {
+        VirgilDecodeError error;
+        if(!Check(fields, error))
+            VirgilThrowDecodeError(error);
+        selfID = fields.messageID;
+        channel = fields.GetChannel();
+        if(fields.Has(VirgilKey::responseID))
+            responseID = fields.responseID;
         isOutbound = outbound;
     }
 
+    // Checks decoded fields without throwing. Returns false and fills in error if the fields constructor would throw.
+    static bool Check(const MessageFields& fields, VirgilDecodeError& error) {
+        return fields.CheckType(MessageType::infoRequest, "InfoRequest", error) && fields.Check(VirgilKey::messageID, "InfoRequest", error) && 
+            fields.CheckChannel(error);
+    }
+
     /// @brief Constructs an InfoRequest with given parameters.
     /// @param msgId The message ID of this InfoRequest.
     /// @param outbound True if the message is outbound, false if inbound.
@@ -626,6 +4259,17 @@ public:
         channel.AppendJson(j);
         return j;
     }
+
+    // Appends the InfoRequest as compact JSON text. Writes the same fields as to_json().
+    void serialize(JsonWriter& writer) const override {
+        WriteHeader(writer, MessageType::infoRequest);
+        if(responseID) {
+            writer.Key("responseID");
+            writer.String(responseID->to_array());
+        }
+        channel.AppendJson(writer);
+        writer.EndObject();
+    }
 };
 
 /**
@@ -660,69 +4304,38 @@ public:
  * @see Parameter struct for individual parameter structure
  * @see LinkedChannelInfo for linked channel information structure
  */
-class InfoResponse : public Message {
+class InfoResponse final : public Message {
+public:
     ChannelID channel; // The channel to request info about
-    std::vector<LinkedChannelInfo> linkedChannels; // List of linked channels
-    std::vector<Parameter> parameters; // List of parameters for the channel
+    LinkedChannelList linkedChannels; // List of linked channels
+    ParameterList parameters; // List of parameters for the channel
 
     // Constructs an InfoResponse from a JSON object.
-    InfoResponse(const nlohmann::json& j, bool outbound) {
-        // Double checks that this is an InfoResponse message
-        if(!j.contains("messageType"))
-            throw std::invalid_argument("InfoResponse JSON must contain 'messageType' field");
-        
-        std::string msgType = j.at("messageType").get<std::string>();
-        if(msgType != "infoResponse")
-            throw std::invalid_argument("InfoResponse JSON must have messageType='infoResponse', but received messageType='" + msgType + "'");
-        
-        // Makes sure required fields are present
-        if(!j.contains("messageID"))
-            throw std::invalid_argument("InfoResponse JSON must contain 'messageID' field");
-        // Reads responseID if present. This is required for InfoResponse messages.
-        if(!j.contains("responseID"))
-            throw std::invalid_argument("InfoResponse JSON must contain 'responseID' field");
-
-        // Reads messageID and constructs from string
-        selfID = MessageID(j.at("messageID").get<std::string>());
-        responseID = MessageID(j.at("responseID").get<std::string>());
-
-        // Read channel identification information
-        channel = ChannelID(j);
-
-        // Parse all additional fields in the JSON as either linkedChannels or parameters
-        // This follows Virgil protocol where everything except messageType, messageID, responseID,
-        // channelIndex, and channelType are treated as channel parameters
-        for (const auto& [key, value] : j.items()) {
-            // Skip the standard message and channel identification fields
-            if (key == "messageType" || key == "messageID" || key == "responseID" || 
-                key == "channelIndex" || key == "channelType") {
-                continue; // These are handled separately above
-            }
-            
-            // Special handling for linkedChannels - this is a mandatory parameter per Virgil protocol
-            // that contains an array of linked device/channel information
-            if(key == "linkedChannels"){
-                if(!value.is_array())
-                    throw std::invalid_argument("Field 'linkedChannels' must be an array, but received type: " + 
-                        std::string(value.type_name()));
-                for(size_t i = 0; i < value.size(); ++i){
-                    const auto& item = value[i];
-                    if(!item.is_object())
-                        throw std::invalid_argument("linkedChannels[" + std::to_string(i) + "] must be an object, but received type: " + 
-                            std::string(item.type_name()));
-                    linkedChannels.push_back(LinkedChannelInfo(item));
-                }
-                continue;
-            }
-            
-            // All other fields are treated as channel parameters (gain, pad, phantomPower, etc.)
-            // Each parameter contains value, dataType, readOnly, and constraints
-            parameters.push_back(Parameter(key, value));
-        }
-        // Sets outbound status. This must be provided by the caller since the bare message does not include this information.
+    InfoResponse(const nlohmann::json& j, bool outbound) : InfoResponse(MessageFields::FromJSON(j), outbound) {}
+
+    /// @brief Constructs an InfoResponse from decoded message fields.
+    /// The decoded linkedChannels and parameters are moved out of `fields`.
+    /// @param fields The decoded message. messageType must be infoResponse.
+    /// @param outbound True if the message is outbound, false if inbound.
+    InfoResponse(MessageFields&& fields, bool outbound) {
+        VirgilDecodeError error;
+        if(!Check(fields, error))
+            VirgilThrowDecodeError(error);
+        selfID = fields.messageID;
+        responseID = fields.responseID;
+        channel = fields.GetChannel();
+        linkedChannels = std::move(fields.linkedChannels);
+        parameters = std::move(fields.parameters);
         isOutbound = outbound;
     }
 
+    /// @brief Checks, without throwing, that decoded fields hold a valid InfoResponse.
+    /// @return false, with error filled in, if the fields constructor would throw
+    static bool Check(const MessageFields& fields, VirgilDecodeError& error) {
+        return fields.CheckType(MessageType::infoResponse, "InfoResponse", error) && fields.Check(VirgilKey::messageID, "InfoResponse", error) && 
+            fields.Check(VirgilKey::responseID, "InfoResponse", error) && fields.CheckChannel(error);
+    }
+
     /// @brief Constructs an InfoResponse with given parameters.
     /// @param msgId The message ID of this InfoResponse.
     /// @param outbound True if the message is outbound, false if inbound.
@@ -730,7 +4343,7 @@ class InfoResponse : public Message {
     /// @param linkedChans The linked channels for this InfoResponse.
     /// @param params The parameters for this InfoResponse.
     /// @param respId The response ID for this InfoResponse.
-    InfoResponse(const MessageID& msgId, bool outbound, const ChannelID& channelId, const std::vector<LinkedChannelInfo>& linkedChans, const std::vector<Parameter>& params, MessageID respId) {
+    InfoResponse(const MessageID& msgId, bool outbound, const ChannelID& channelId, const LinkedChannelList& linkedChans, const ParameterList& params, MessageID respId) {
         responseID = respId;
         selfID = msgId;
         isOutbound = outbound;
@@ -738,14 +4351,29 @@ class InfoResponse : public Message {
         linkedChannels = linkedChans;
         parameters = params;
     }
-    // Converts the InfoRequest to a JSON object for sending.
+
+    /// @brief Finds a parameter by name. Names are compared as interned symbols, so this is an integer compare per parameter.
+    /// @return The parameter, or nullptr if the channel has no parameter with that name
+    const Parameter* FindParameter(ParameterName name) const {
+        for (const Parameter& param : parameters)
+            if (param.name == name)
+                return &param;
+        return nullptr;
+    }
+
+    /// @brief Finds a parameter by name. See FindParameter(ParameterName) const.
+    Parameter* FindParameter(ParameterName name) {
+        return const_cast<Parameter*>(static_cast<const InfoResponse*>(this)->FindParameter(name));
+    }
+
+    // Converts the InfoResponse to a JSON object for sending.
     nlohmann::json to_json() const override {
         //Validates that responseID is present
         if(!responseID)
-            throw std::invalid_argument("InfoResponse must have a responseID to identify which request it responds to");
+            VirgilThrowInvalidArgument("InfoResponse must have a responseID to identify which request it responds to");
         nlohmann::json j;
         //Sets basic fields
-        j["messageType"] = "infoRequest";
+        j["messageType"] = "infoResponse";
 
         //Generates messageID if missing
         if(selfID)
@@ -770,818 +4398,1826 @@ class InfoResponse : public Message {
 
         return j;
     }
+
+    /// @brief Appends the InfoResponse as compact JSON text. Writes the same fields as to_json().
+    /// @throws std::invalid_argument if responseID is missing, or a linked channel or parameter is invalid
+    void serialize(JsonWriter& writer) const override {
+        if(!responseID)
+            VirgilThrowInvalidArgument("InfoResponse must have a responseID to identify which request it responds to");
+        WriteHeader(writer, MessageType::infoResponse);
+        writer.Key("responseID");
+        writer.String(responseID->to_array());
+        channel.AppendJson(writer);
+        writer.Key("linkedChannels");
+        writer.BeginArray();
+        for (const auto& linkedChan : linkedChannels)
+            linkedChan.serialize(writer);
+        writer.EndArray();
+        for (const auto& param : parameters)
+            param.append_json(writer);
+        writer.EndObject();
+    }
 };
 
 /**
- * @brief A struct representing a Virgil Protocol parameter with validation and JSON serialization.
+ * @brief A message of any implemented type, stored by value.
  * 
- * Parameters are the core data structure for controlling and monitoring audio device settings
- * in the Virgil Protocol 2.3.0. Each parameter contains a current value, data type information,
- * constraints, and metadata required for proper validation and UI generation.
+ * AnyMessage is the closed alternative to owning a Message through a pointer: messages can be
+ * kept inline in vectors and queues with no allocation per message, and handled with std::visit,
+ * which dispatches on the stored index instead of through the vtable. The Message subclasses are
+ * final, so calls made on the concrete type inside a visitor (such as serialize()) are direct calls.
  * 
- * Supported parameter types and their requirements:
+ * @example
+ * ```cpp
+ * std::vector<AnyMessage> inbox;
+ * inbox.push_back(MessageDecoder::DecodeValue(text, false));
+ * for (const AnyMessage& msg : inbox) {
+ *     std::visit(MessageHandlers{
+ *         [](const InfoResponse& response) { ... },
+ *         [](const ErrorResponse& error) { ... },
+ *         [](const auto& other) { ... } // Every other type
+ *     }, msg);
+ * }
+ * ```
  * 
- * **Control Parameters** (user-controllable):
- * - gain (required): Analog gain, independent of pad. Units: dB. Type: int/float
- * - pad: Input attenuator control. Type: bool
- * - padLevel: Pad attenuation amount. Units: dB. Type: int (usually negative)
- * - lowcut: High-pass filter frequency. Units: Hz. Type: int/float  
- * - lowcutEnable: Enable/disable high-pass filter. Type: bool
- * - polarity: Signal polarity (phase invert). Type: bool
- * - phantomPower: Phantom power control. Type: bool
- * - rfEnable: RF transmitter/receiver control. Type: bool
- * - transmitPower: Transmitter power level. Type: enum/int/float. Units: %
- * - squelch: Squelch threshold. Type: int/float. Units: dB or %
+ * @see AnyMessageFromJSON, MessageDecoder::DecodeValue
+ */
+using AnyMessage = std::variant<ChannelLink, ChannelUnlink, EndResponse, ErrorResponse, InfoRequest, InfoResponse>;
+
+/// @brief Combines lambdas into one visitor for std::visit, one overload per message type.
+template <class... Handlers>
+struct MessageHandlers : Handlers... {
+    using Handlers::operator()...;
+};
+
+template <class... Handlers>
+MessageHandlers(Handlers...) -> MessageHandlers<Handlers...>;
+
+// MessageType of each AnyMessage alternative, indexed by AnyMessage::index()
+inline constexpr std::array<MessageType, std::variant_size_v<AnyMessage>> AnyMessageTypes = {
+    MessageType::channelLink,
+    MessageType::channelUnlink,
+    MessageType::endResponse,
+    MessageType::errorResponse,
+    MessageType::infoRequest,
+    MessageType::infoResponse
+};
+
+/// @brief Gets the MessageType of the message held by an AnyMessage.
+inline MessageType GetMessageType(const AnyMessage& message) {
+    return AnyMessageTypes[message.index()];
+}
+
+/// @brief Gets the held message through its Message base, e.g. to read selfID or responseID.
+inline const Message& AsMessage(const AnyMessage& message) {
+    return std::visit([](const Message& held) -> const Message& { return held; }, message);
+}
+
+/// @brief Gets the held message through its Message base, e.g. to read selfID or responseID.
+inline Message& AsMessage(AnyMessage& message) {
+    return std::visit([](Message& held) -> Message& { return held; }, message);
+}
+
+// The constructors of one Message subclass, as stored in MessageFactories.
+struct MessageFactory {
+    Message* (*fromJSON)(const nlohmann::json& j, bool outbound) = nullptr; // Constructs from a parsed JSON object
+    Message* (*fromFields)(MessageFields&& fields, bool outbound) = nullptr; // Constructs from fields decoded by MessageDecoder
+    MessagePtr (*fromJSONPooled)(const nlohmann::json& j, bool outbound) = nullptr; // fromJSON, allocated from the type's MessagePool
+    MessagePtr (*fromFieldsPooled)(MessageFields&& fields, bool outbound) = nullptr; // fromFields, allocated from the type's MessagePool
+    AnyMessage (*fromJSONValue)(const nlohmann::json& j, bool outbound) = nullptr; // fromJSON, returned by value
+    AnyMessage (*fromFieldsValue)(MessageFields&& fields, bool outbound) = nullptr; // fromFields, returned by value
+    bool (*check)(const MessageFields& fields, VirgilDecodeError& error) = nullptr; // Reports, without throwing, whether fromFields would throw
+};
+
+/**
+ * @brief Recycles the memory of messages of one type, so decoding does not need a heap round trip per message.
+ * 
+ * Each thread keeps its own free list of message-sized blocks, so allocating and freeing never
+ * locks. A block freed on a different thread than the one that allocated it simply joins the
+ * freeing thread's list. Each list keeps at most MaxCachedBlocks blocks; extra blocks, and the
+ * cached blocks of a thread that exits, go back to the heap.
+ * 
+ * @tparam T The Message subclass to pool
+ * @see MessageDeleter, Message::FromJSONPooled
+ */
+template <class T>
+class MessagePool {
+public:
+    static constexpr size_t MaxCachedBlocks = 256; ///< Free blocks kept per thread
+
+    /// @brief Constructs a T in pooled memory.
+    /// @throws Whatever the constructor of T throws. The memory is returned to the pool.
+    template <class... Args>
+    static MessagePtr Make(Args&&... args) {
+        void* block = Allocate();
+        T* message;
+        VIRGIL_TRY {
+            message = new (block) T(std::forward<Args>(args)...);
+        } VIRGIL_CATCH_ALL {
+            Free(block);
+            VIRGIL_RETHROW;
+        }
+        return MessagePtr(message, MessageDeleter{&Release});
+    }
+
+private:
+    // Free blocks are linked through their first bytes
+    struct Block {
+        Block* next;
+    };
+
+    struct FreeList {
+        Block* head = nullptr;
+        size_t size = 0;
+
+        ~FreeList() {
+            while(head) {
+                Block* next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    };
+
+    static_assert(sizeof(T) >= sizeof(Block), "MessagePool blocks must fit the free list link");
+
+    static FreeList& Local() {
+        thread_local FreeList list;
+        return list;
+    }
+
+    static void* Allocate() {
+        FreeList& list = Local();
+        if(!list.head)
+            return ::operator new(sizeof(T));
+        Block* block = list.head;
+        list.head = block->next;
+        --list.size;
+        return block;
+    }
+
+    static void Free(void* memory) {
+        FreeList& list = Local();
+        if(list.size >= MaxCachedBlocks) {
+            ::operator delete(memory);
+            return;
+        }
+        list.head = new (memory) Block{list.head};
+        ++list.size;
+    }
+
+    static void Release(Message* message) {
+        T* typed = static_cast<T*>(message);
+        typed->~T();
+        Free(typed);
+    }
+};
+
+// Builds the MessageFactory for any Message subclass with JSON and MessageFields constructors and a static Check().
+template <class T>
+constexpr MessageFactory MakeMessageFactory() {
+    MessageFactory factory;
+    factory.fromJSON = [](const nlohmann::json& j, bool outbound) -> Message* { return new T(j, outbound); };
+    factory.fromFields = [](MessageFields&& fields, bool outbound) -> Message* { return new T(std::move(fields), outbound); };
+    factory.fromJSONPooled = [](const nlohmann::json& j, bool outbound) { return MessagePool<T>::Make(j, outbound); };
+    factory.fromFieldsPooled = [](MessageFields&& fields, bool outbound) { return MessagePool<T>::Make(std::move(fields), outbound); };
+    factory.fromJSONValue = [](const nlohmann::json& j, bool outbound) { return AnyMessage(std::in_place_type<T>, j, outbound); };
+    factory.fromFieldsValue = [](MessageFields&& fields, bool outbound) { return AnyMessage(std::in_place_type<T>, std::move(fields), outbound); };
+    factory.check = &T::Check;
+    return factory;
+}
+
+/**
+ * @brief Registry of Message constructors, indexed by MessageType.
+ * 
+ * Message::FromJSON and MessageDecoder resolve the messageType string to a MessageType and call
+ * the factory stored here. Message types that are defined by Virgil Protocol 2.3.0 but do not
+ * have a Message subclass yet hold an empty MessageFactory, and are reported as not yet implemented.
+ * 
+ * @note When implementing a new message type, replace its empty entry with MakeMessageFactory<NewType>()
+ */
+inline constexpr std::array<MessageFactory, MessageTypeCount> MessageFactories = {
+    MakeMessageFactory<ChannelLink>(),    // channelLink
+    MakeMessageFactory<ChannelUnlink>(),  // channelUnlink
+    MakeMessageFactory<InfoRequest>(),    // infoRequest
+    MakeMessageFactory<InfoResponse>(),   // infoResponse
+    MessageFactory{},                     // deviceInfoRequest
+    MessageFactory{},                     // deviceInfoResponse
+    MessageFactory{},                     // parameterCommand
+    MessageFactory{},                     // statusUpdate
+    MessageFactory{},                     // statusRequest
+    MessageFactory{},                     // subscribeMessage
+    MessageFactory{},                     // unsubscribeMessage
+    MakeMessageFactory<ErrorResponse>(),  // errorResponse
+    MakeMessageFactory<EndResponse>()     // endResponse
+};
+
+inline void MessageDeleter::operator()(Message* message) const {
+    if(release)
+        release(message);
+    else
+        delete message;
+}
+
+inline MessageFields MessageFields::FromJSON(const nlohmann::json& j)
+{
+    MessageFields fields;
+    VirgilDecodeError error;
+    if(!Read(j, fields, error))
+        VirgilThrowDecodeError(error);
+    return fields;
+}
+
+inline bool MessageFields::Read(const nlohmann::json& j, MessageFields& fields, VirgilDecodeError& error)
+{
+    if(!j.is_object()) {
+        error = VirgilDecodeError::NotAnObject("Message", j.type_name());
+        return false;
+    }
+
+    // Only some message types carry parameters, and messageType can come after them, so it is looked up first.
+    // A missing or invalid messageType is reported by the main loop
+    auto typeField = j.find("messageType");
+    std::optional<MessageType> type;
+    if(typeField != j.end() && typeField->is_string())
+        type = ParseMessageType(typeField->get_ref<const std::string&>());
+    bool readParameters = type && CarriesParameters(*type);
+
+    // Every object value is a parameter (message fields are never objects), so the list can be sized once
+    if(readParameters) {
+        size_t parameterCount = 0;
+        for (const nlohmann::json& value : j)
+            parameterCount += value.is_object();
+        fields.parameters.reserve(parameterCount);
+    }
+
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        const nlohmann::json& value = it.value();
+        std::optional<VirgilKey> key = ParseVirgilKey(it.key());
+        // Keys after linkedChannels belong to parameters and linkedChannels entries, so at this level they are parameter names
+        if(!key || *key > VirgilKey::linkedChannels) {
+            // Object-valued keys that are not message fields are parameters, if this type has any
+            if(readParameters && value.is_object()) {
+                if(ListIsFull(fields.parameters)) {
+                    error = VirgilDecodeError::TooManyEntries("parameters", fields.parameters.capacity());
+                    return false;
+                }
+                if(!Parameter::EmplaceFromJSON(fields.parameters, it.key(), value, error))
+                    return false;
+            }
+            continue;
+        }
+
+        // Each reader returns false and fills in error if the value has the wrong type
+        auto typeError = [&](const char* expected, const char* received) {
+            error = VirgilDecodeError::WrongType(nullptr, *key, expected, received);
+            return false;
+        };
+        auto readString = [&](std::string& out) {
+            if(!value.is_string())
+                return typeError("a string", value.type_name());
+            out = value.get_ref<const std::string&>();
+            return true;
+        };
+        auto readMessageID = [&](MessageID& out) {
+            if(!value.is_string())
+                return typeError("a string", value.type_name());
+            VirgilResult<MessageID> id = MessageID::TryParse(value.get_ref<const std::string&>());
+            if(!id) {
+                error = id.Error();
+                return false;
+            }
+            out = *id;
+            return true;
+        };
+        auto readUnsigned = [&](uint64_t& out) {
+            if(!value.is_number_unsigned())
+                return typeError("an unsigned integer", value.is_number_integer() ? "negative integer" : value.type_name());
+            out = value.get<uint64_t>();
+            return true;
+        };
+
+        bool valid = true;
+        switch(*key) {
+            case VirgilKey::messageType: {
+                if(!value.is_string())
+                    return typeError("a string", value.type_name());
+                const std::string& messageType = value.get_ref<const std::string&>();
+                std::optional<MessageType> type = ParseMessageType(messageType);
+                if(!type) {
+                    error = VirgilDecodeError::UnknownMessageType(messageType);
+                    return false;
+                }
+                fields.messageType = *type;
+                break;
+            }
+            case VirgilKey::messageID:
+                valid = readMessageID(fields.messageID);
+                break;
+            case VirgilKey::responseID:
+                valid = readMessageID(fields.responseID);
+                break;
+            case VirgilKey::channelIndex:
+                valid = readUnsigned(fields.channelIndex);
+                break;
+            case VirgilKey::channelType:
+                valid = readUnsigned(fields.channelType);
+                break;
+            case VirgilKey::sendingChannelIndex:
+                valid = readUnsigned(fields.sendingChannelIndex);
+                break;
+            case VirgilKey::sendingChannelType:
+                valid = readUnsigned(fields.sendingChannelType);
+                break;
+            case VirgilKey::errorValue:
+                valid = readString(fields.errorValue);
+                break;
+            case VirgilKey::errorString:
+                valid = readString(fields.errorString);
+                break;
+            case VirgilKey::linkedChannels:
+                if(!value.is_array())
+                    return typeError("an array", value.type_name());
+                fields.linkedChannels.reserve(value.size());
+                for(size_t i = 0; i < value.size(); ++i) {
+                    const nlohmann::json& item = value[i];
+                    if(!item.is_object()) {
+                        error = VirgilDecodeError::EntryNotAnObject("linkedChannels", i, item.type_name());
+                        return false;
+                    }
+                    if(ListIsFull(fields.linkedChannels)) {
+                        error = VirgilDecodeError::TooManyEntries("linkedChannels", fields.linkedChannels.capacity());
+                        return false;
+                    }
+                    VirgilResult<LinkedChannelInfo> linked = LinkedChannelInfo::TryFromJSON(item);
+                    if(!linked) {
+                        error = linked.Error();
+                        return false;
+                    }
+                    fields.linkedChannels.push_back(std::move(*linked));
+                }
+                break;
+            default:
+                break;
+        }
+        if(!valid)
+            return false;
+        fields.present |= VirgilKeyBit(*key);
+    }
+    return true;
+}
+
+inline const MessageFactory& Message::FactoryFor(const nlohmann::json& j)
+{
+    if(!j.is_object())
+        VirgilThrowDecodeError(VirgilDecodeError::NotAnObject("Message", j.type_name()));
+    auto typeField = j.find("messageType");
+
+    if(typeField == j.end())
+        VirgilThrowDecodeError(VirgilDecodeError::MissingField("Message", VirgilKey::messageType));
+    if(!typeField->is_string())
+        VirgilThrowDecodeError(VirgilDecodeError::WrongType(nullptr, VirgilKey::messageType, "a string", typeField->type_name()));
+
+    // Reads the string in place. No copy is made.
+    const std::string& messageType = typeField->get_ref<const std::string&>();
+    std::optional<MessageType> type = ParseMessageType(messageType);
+    if(!type)
+        VirgilThrowDecodeError(VirgilDecodeError::UnknownMessageType(messageType));
+
+    const MessageFactory& factory = MessageFactories[static_cast<size_t>(*type)];
+    if(!factory.fromJSON)
+        VirgilThrowDecodeError(VirgilDecodeError::NotImplemented(messageType));
+
+    return factory;
+}
+
+inline Message* Message::FromJSON(const nlohmann::json& j, bool outbound)
+{
+    return FactoryFor(j).fromJSON(j, outbound);
+}
+
+inline MessagePtr Message::FromJSONPooled(const nlohmann::json& j, bool outbound)
+{
+    return FactoryFor(j).fromJSONPooled(j, outbound);
+}
+
+inline const MessageFactory* Message::FindFactory(const MessageFields& fields, VirgilDecodeError& error)
+{
+    if(!fields.Check(VirgilKey::messageType, "Message", error))
+        return nullptr;
+    const MessageFactory& factory = MessageFactories[static_cast<size_t>(fields.messageType)];
+    if(!factory.fromFields) {
+        error = VirgilDecodeError::NotImplemented(MessageTypeName(fields.messageType));
+        return nullptr;
+    }
+    return &factory;
+}
+
+inline VirgilResult<MessagePtr> Message::TryFromJSON(const nlohmann::json& j, bool outbound)
+{
+    MessageFields fields;
+    VirgilDecodeError error;
+    if(!MessageFields::Read(j, fields, error))
+        return error;
+    const MessageFactory* factory = FindFactory(fields, error);
+    if(!factory || !factory->check(fields, error))
+        return error;
+    return factory->fromFieldsPooled(std::move(fields), outbound);
+}
+
+/**
+ * @brief Same as Message::FromJSON(), but returns the message by value as an AnyMessage.
+ * 
+ * @param j The JSON object containing the message data. Must include "messageType" field.
+ * @param outbound True if the message is outbound (being sent), false if inbound (received).
+ * @throws std::invalid_argument under the same conditions as Message::FromJSON()
+ */
+inline AnyMessage AnyMessageFromJSON(const nlohmann::json& j, bool outbound)
+{
+    return Message::FactoryFor(j).fromJSONValue(j, outbound);
+}
+
+/**
+ * @brief One decoded Virgil packet: the transmitting device and the messages it carried.
  * 
- * **Status Parameters** (read-only):
- * - deviceConnected: Wireless device connection status. Type: bool
- * - subDevice: Type of connected device. Type: string (handheld, beltpack, etc.)
+ * Every Virgil packet on the wire is an envelope of the form
+ * `{"transmittingDevice": "...", "messages": [ {...}, {...} ]}`.
  * 
- * **Continuous Parameters** (real-time monitoring, read-only):
- * - audioLevel: Audio signal level. Type: float. Units: dBFS
- * - rfLevel: RF signal strength. Type: int/float. Units: dB or %
- * - batteryLevel: Battery level. Type: int. Units: %
+ * @see MessageDecoder::DecodeEnvelope
+ * @see StreamFramer for splitting a TCP stream into envelopes
+ */
+struct VirgilEnvelope {
+    std::string transmittingDevice; // Name of the device that sent the packet
+    std::vector<MessagePtr> messages; // Decoded messages, in the order they were sent. Allocated from MessagePools.
+};
+
+/**
+ * @brief Decodes a single Virgil message directly from JSON text, without building a nlohmann::json DOM.
  * 
- * **Special Parameters**:
- * - linkedChannels: Mandatory array of linked channel information
+ * MessageDecoder is a SAX handler for nlohmann::json::sax_parse. As the parser walks the input, each
+ * key is classified with ParseVirgilKey() and only the values the message needs are stored, straight
+ * into a MessageFields record. linkedChannels entries and parameters are built as soon as their
+ * objects close. When the message is complete, the record is handed to the Message subclass
+ * registered in MessageFactories for its messageType.
  * 
- * Data type validation follows the formula for numeric parameters:
- * `isValid = (value - minValue) % precision == 0 && value >= minValue && value <= maxValue`
+ * Compared to `Message::FromJSON(nlohmann::json::parse(text), outbound)` this skips allocating and
+ * freeing a heap node for every value in the message, while applying the same validation.
  * 
- * @see Virgil Protocol 2.3.0 - "Parameters" section for complete specification
- * @note Non-readonly numeric parameters must specify minValue, maxValue, and precision
- * @note The list of parameters seen above is not checked anywhere. That is just what is specified in the current Virgil version. Aux channels are allowed to make things up.
+ * Decoding rules:
+ * - The top-level value must be an object
+ * - Known message fields must have the types the protocol specifies (string IDs, unsigned channel fields, ...)
+ * - For the message types that carry parameters (see CarriesParameters()), any other object-valued key
+ *   is decoded as a Parameter named after the key. For every other type it is ignored
+ * - Any other key with a scalar or array value is ignored, as are unknown keys inside
+ *   linkedChannels entries and parameter objects
+ * 
+ * DecodeEnvelope() decodes a whole packet the same way, constructing each message as soon as its
+ * object closes.
+ * 
+ * @example
+ * ```cpp
+ * std::string text = // ... one message from the messages array
+ * std::unique_ptr<Message> msg(MessageDecoder::Decode(text, false)); // false = inbound
+ * ```
+ * 
+ * @note The SAX callbacks are public because nlohmann::json calls them. Use Decode() rather than calling them directly.
+ * @see MessageFields for the decoded record
  */
-struct Parameter {
-    std::string name; // Parameter name
-    std::string dataType; // "number", "bool", "string", or "enum"
-    std::optional<std::string> unit; // Unit of measurement. Shorthand like "dB" or "Hz"
-    std::variant<int,float,bool,std::string> value; // Current value
-    std::optional<std::variant<int,float>> minValue; // Minimum value for number types
-    std::optional<std::variant<int,float>> maxValue; // Maximum value for number types
-    std::optional<std::variant<int,float>> precision; // Precision for number types
-    bool readOnly; // True if parameter is read-only
+class MessageDecoder {
+public:
+    /**
+     * @brief Decodes one message from JSON text.
+     * 
+     * @param text The JSON text of a single message object.
+     * @param outbound True if the message is outbound (being sent), false if inbound (received).
+     * @return A pointer to a newly allocated Message subclass instance.
+     * @throws std::invalid_argument if the text is not valid JSON, a field has the wrong type,
+     *         or the message is not a valid message of an implemented messageType
+     * @note Caller is responsible for deleting the returned pointer
+     */
+    static Message* Decode(std::string_view text, bool outbound) {
+        MessageDecoder decoder;
+        const MessageFactory* factory = decoder.Parse(text);
+        if(!factory)
+            VirgilThrowDecodeError(decoder.error);
+        return factory->fromFields(std::move(decoder.fields), outbound);
+    }
 
-    /// @brief Constructs a Parameter from a JSON object.
-    /// @param j The JSON object to parse. This should not contain the name.
-    Parameter(const std::string& paramName, const nlohmann::json& j)
-    {
-        // Validates presence of required fields
-        if(!j.contains("dataType"))
-            throw std::invalid_argument("Parameter '" + paramName + "' JSON must contain 'dataType' field");
-        if(!j.contains("value"))
-            throw std::invalid_argument("Parameter '" + paramName + "' JSON must contain 'value' field");
-        if(!j.contains("readOnly"))
-            throw std::invalid_argument("Parameter '" + paramName + "' JSON must contain 'readOnly' field");
-        
-        bool isReadOnly = j.at("readOnly").get<bool>();
-        std::string dataTypeStr = j.at("dataType").get<std::string>();
+    /// @brief Same as Decode(), but the message is allocated from the MessagePool of its type and returned owned.
+    /// @throws std::invalid_argument under the same conditions as Decode()
+    static MessagePtr DecodePooled(std::string_view text, bool outbound) {
+        return TryDecode(text, outbound).Value();
+    }
 
-        // Parses based on dataType
-        if(dataTypeStr == "string") {
-            std::string value = j.at("value").get<std::string>();
-            *this = Parameter(paramName, value, isReadOnly);
-        }
-        else if(dataTypeStr == "bool") {
-            bool value = j.at("value").get<bool>();
-            *this = Parameter(paramName, value, isReadOnly);
-        }
-        else if(dataTypeStr == "enum") {
-            // For enum, we need to reconstruct the VirgilEnum from the JSON
-            std::string value = j.at("value").get<std::string>();
-            if(!j.contains("enumValues"))
-                throw std::invalid_argument("Enum parameter '" + paramName + "' JSON must contain 'enumValues' field");
-            std::vector<std::string> enumValues = j.at("enumValues").get<std::vector<std::string>>();
-            VirgilEnum enumValue(value, enumValues);
-            *this = Parameter(paramName, enumValue, isReadOnly);
-        }
-        else if(dataTypeStr == "int") {
-            if(!j.contains("unit"))
-                throw std::invalid_argument("Integer parameter '" + paramName + "' JSON must contain 'unit' field");
-            std::string unitStr = j.at("unit").get<std::string>();
-            int value = j.at("value").get<int>();
-                std::optional<int> minVal, maxVal, prec;
-                if(j.contains("minValue"))
-                    minVal = j.at("minValue").get<int>();
-                if(j.contains("maxValue"))
-                    maxVal = j.at("maxValue").get<int>();
-                if(j.contains("precision"))
-                    prec = j.at("precision").get<int>();
-                *this = Parameter(paramName, value, isReadOnly, unitStr, minVal, maxVal, prec);
-        }
-        else if(dataTypeStr == "float")
-        {
-            if(!j.contains("unit"))
-                throw std::invalid_argument("Float parameter '" + paramName + "' JSON must contain 'unit' field");
-            std::string unitStr = j.at("unit").get<std::string>();
-
-            float value = j.at("value").get<float>();
-            std::optional<float> minVal, maxVal, prec;
-            if(j.contains("minValue"))
-                minVal = j.at("minValue").get<float>();
-            if(j.contains("maxValue"))
-                maxVal = j.at("maxValue").get<float>();
-            if(j.contains("precision"))
-                prec = j.at("precision").get<float>();
-            *this = Parameter(paramName, value, isReadOnly, unitStr, minVal, maxVal, prec);
-        }
-        else {
-            throw std::invalid_argument("Parameter '" + paramName + "' has unknown dataType: '" + dataTypeStr + 
-                "'. Supported types: 'string', 'bool', 'enum', 'int', 'float'");
-        }
+    /// @brief Same as Decode(), but returns the message by value as an AnyMessage. Nothing is allocated for the message itself.
+    /// @throws std::invalid_argument under the same conditions as Decode()
+    static AnyMessage DecodeValue(std::string_view text, bool outbound) {
+        MessageDecoder decoder;
+        const MessageFactory* factory = decoder.Parse(text);
+        if(!factory)
+            VirgilThrowDecodeError(decoder.error);
+        return factory->fromFieldsValue(std::move(decoder.fields), outbound);
     }
 
-    // Constructor for string parameters
-    Parameter(const std::string& paramName, const std::string& paramValue, bool isReadOnly)
-    {
-        if(paramName.empty())
-            throw std::invalid_argument("Parameter name cannot be empty when creating string parameter");
-        name = paramName;
-        dataType = "string";
-        value = paramValue;
-        readOnly = isReadOnly;
+    /**
+     * @brief Same as DecodePooled(), but returns the error instead of throwing it.
+     * 
+     * Nothing is thrown for malformed or invalid input; the parser stops at the first error and
+     * it is returned. Only allocation failures are still thrown.
+     * 
+     * @param text The JSON text of a single message object.
+     * @param outbound True if the message is outbound (being sent), false if inbound (received).
+     * @return The decoded message, or the reason it could not be decoded
+     */
+    static VirgilResult<MessagePtr> TryDecode(std::string_view text, bool outbound) {
+        MessageDecoder decoder;
+        const MessageFactory* factory = decoder.Parse(text);
+        if(!factory)
+            return decoder.error;
+        return factory->fromFieldsPooled(std::move(decoder.fields), outbound);
     }
 
-    // Constructor for VirgilEnum parameters. These are just strings with a predefined set of valid values.
-    Parameter(const std::string& paramName, const VirgilEnum& paramValue, bool isReadOnly)
-    {
-        if(paramName.empty())
-            throw std::invalid_argument("Parameter name cannot be empty when creating enum parameter '" + paramName + "'");
-        if(!paramValue)
-            throw std::invalid_argument("Invalid enum value for parameter '" + paramName + "'. Enum value '" + 
-                paramValue.value + "' is not in the allowed values list.");
-        name = paramName;
-        dataType = "enum";
-        value = paramValue;
-        readOnly = isReadOnly;
+    /**
+     * @brief Decodes a whole Virgil packet (the transmittingDevice / messages envelope) from JSON text.
+     * 
+     * Each message is validated exactly as Decode() would validate it on its own.
+     * Unknown envelope keys are ignored.
+     * 
+     * @param text The JSON text of one envelope, e.g. a view returned by StreamFramer::Next()
+     * @param outbound True if the messages are outbound (being sent), false if inbound (received).
+     * @return The transmitting device and the decoded messages
+     * @throws std::invalid_argument if the text is not valid JSON, the envelope is missing
+     *         'transmittingDevice' or 'messages', or any message fails to decode
+     */
+    static VirgilEnvelope DecodeEnvelope(std::string_view text, bool outbound) {
+        return TryDecodeEnvelope(text, outbound).Value();
     }
 
-    // Constructor for int parameters
-    Parameter(const std::string& paramName, int paramValue, bool isReadOnly, const std::string& unitStr, std::optional<int> minVal, std::optional<int> maxVal, std::optional<int> prec)
-    {
-        if(paramName.empty())
-            throw std::invalid_argument("Parameter name cannot be empty when creating integer parameter");
-        if(unitStr.empty())
-            throw std::invalid_argument("Unit cannot be empty for integer parameter '" + paramName + "'");
-        if((minVal && maxVal) && (*minVal > *maxVal))
-            throw std::invalid_argument("Parameter '" + paramName + "': minValue (" + std::to_string(*minVal) + 
-                ") cannot be greater than maxValue (" + std::to_string(*maxVal) + ")");
-        if(prec && *prec <= 0)
-            throw std::invalid_argument("Parameter '" + paramName + "': precision (" + std::to_string(*prec) + 
-                ") must be greater than 0");
-        if(!isReadOnly && (!minVal || !maxVal || !prec))
-            throw std::invalid_argument("Non-readonly integer parameter '" + paramName + 
-                "' must have minValue, maxValue, and precision specified");
-        if(!isReadOnly && minVal && maxVal && prec) {
-            if((paramValue - *minVal) % *prec != 0 || paramValue < *minVal || paramValue > *maxVal)
-                throw std::invalid_argument("Parameter '" + paramName + "': initial value (" + std::to_string(paramValue) + 
-                    ") is not valid. Must be between " + std::to_string(*minVal) + " and " + std::to_string(*maxVal) + 
-                    " in steps of " + std::to_string(*prec));
-        }
-        name = paramName;
-        dataType = "number";
-        value = paramValue;
-        unit = unitStr;
-        if(minValue)
-            minValue = minVal;
-        if(maxValue)
-            maxValue = maxVal;
-        if(precision)
-            precision = prec;
-        readOnly = isReadOnly;
+    /// @brief Same as DecodeEnvelope(), but returns the error instead of throwing it.
+    /// @return The envelope, or the first error. Messages decoded before the error are discarded.
+    static VirgilResult<VirgilEnvelope> TryDecodeEnvelope(std::string_view text, bool outbound) {
+        MessageDecoder decoder;
+        VirgilEnvelope envelope;
+        decoder.envelope = &envelope;
+        decoder.envelopeOutbound = outbound;
+        if(!nlohmann::json::sax_parse(text.data(), text.data() + text.size(), &decoder))
+            return decoder.error;
+        if(!decoder.hasTransmittingDevice)
+            return VirgilDecodeError::MissingField("Virgil envelope", "transmittingDevice");
+        if(!decoder.hasMessages)
+            return VirgilDecodeError::MissingField("Virgil envelope", "messages");
+        return envelope;
     }
 
-    // Constructor for float parameters
-    Parameter(const std::string& paramName, float paramValue, bool isReadOnly, const std::string& unitStr, std::optional<float> minVal, std::optional<float> maxVal, std::optional<float> prec)
-    {
-        if(paramName.empty())
-            throw std::invalid_argument("Parameter name cannot be empty when creating float parameter");
-        if(unitStr.empty())
-            throw std::invalid_argument("Unit cannot be empty for float parameter '" + paramName + "'");
-        if((minVal && maxVal) && (*minVal > *maxVal))
-            throw std::invalid_argument("Parameter '" + paramName + "': minValue (" + std::to_string(*minVal) + 
-                ") cannot be greater than maxValue (" + std::to_string(*maxVal) + ")");
-        if(prec && *prec <= 0)
-            throw std::invalid_argument("Parameter '" + paramName + "': precision (" + std::to_string(*prec) + 
-                ") must be greater than 0");
-        if(!isReadOnly && (!minVal || !maxVal || !prec))
-            throw std::invalid_argument("Non-readonly float parameter '" + paramName + 
-                "' must have minValue, maxValue, and precision specified");
-        name = paramName;
-        dataType = "number";
-        value = paramValue;
-        unit = unitStr;
-        if(minValue)
-            minValue = minVal;
-        if(maxValue)
-            maxValue = maxVal;
-        if(precision)
-            precision = prec;
-        readOnly = isReadOnly;
+    // SAX callbacks called by nlohmann::json::sax_parse. They return false, which stops the parser, after recording an error with Fail().
+
+    bool null() {
+        Scalar scalar;
+        return Value(scalar);
     }
 
-    // Constructor for bool parameters
-    Parameter(const std::string& paramName, const bool paramValue, bool isReadOnly)
-    {
-        if(paramName.empty())
-            throw std::invalid_argument("Parameter name cannot be empty when creating boolean parameter");
-        name = paramName;
-        dataType = "bool";
-        value = paramValue;
-        readOnly = isReadOnly;
+    bool boolean(bool val) {
+        Scalar scalar;
+        scalar.kind = Scalar::Kind::boolean;
+        scalar.boolean = val;
+        return Value(scalar);
     }
 
-    // Converts the Parameter to a JSON object for sending. This does not contain the name field.
-    nlohmann::json to_json() const {
+    bool number_integer(nlohmann::json::number_integer_t val) {
+        Scalar scalar;
+        scalar.kind = Scalar::Kind::integer;
+        scalar.integer = val;
+        return Value(scalar);
+    }
 
-        if(name.empty())
-            throw std::invalid_argument("Parameter name cannot be empty when converting to JSON. Parameter has dataType='" + 
-                dataType + "' but missing name");
-        nlohmann::json j;
-        j["dataType"] = dataType;
+    bool number_unsigned(nlohmann::json::number_unsigned_t val) {
+        if(val <= static_cast<uint64_t>(INT64_MAX))
+            return number_integer(static_cast<int64_t>(val));
+        // Kept exactly, so the field that reads it reports it as out of range (or as the wrong type) like the JSON decoder does
+        Scalar scalar;
+        scalar.kind = Scalar::Kind::bigUnsigned;
+        scalar.bigUnsigned = val;
+        return Value(scalar);
+    }
 
-        std::visit([&j](auto&& arg) { j["value"] = arg; }, value);
+    bool number_float(nlohmann::json::number_float_t val, const std::string&) {
+        Scalar scalar;
+        scalar.kind = Scalar::Kind::floating;
+        scalar.floating = val;
+        return Value(scalar);
+    }
 
-        j["readOnly"] = readOnly;
-        if(unit)
-            j["unit"] = *unit;
-        if(minValue)
-            std::visit([&j](auto&& arg) { j["minValue"] = arg; }, *minValue);
-        if(maxValue)
-            std::visit([&j](auto&& arg) { j["maxValue"] = arg; }, *maxValue);
-        if(precision)
-            std::visit([&j](auto&& arg) { j["precision"] = arg; }, *precision);
-        return j;
+    bool string(std::string& val) {
+        Scalar scalar;
+        scalar.kind = Scalar::Kind::string;
+        scalar.string = &val;
+        return Value(scalar);
     }
 
-    // Appends the Parameter to an existing JSON object with the name as the key.
-    void append_json(nlohmann::json& j) const {
-        j[name] = to_json();
+    bool binary(nlohmann::json::binary_t&) {
+        // JSON text never contains binary values
+        Scalar scalar;
+        return Value(scalar);
     }
 
-    // Validates the Parameter's fields and returns true if valid, false otherwise.
-    // This ensures the parameter conforms to Virgil Protocol 2.3.0 parameter requirements
-    operator bool() const {
-        // Basic validation: parameter must have a name
-        if(name.empty())
-            return false;
+    bool start_object(std::size_t) {
+        ++depth;
+        if(skipDepth) {
+            ++skipDepth;
+            return true;
+        }
+        switch(context) {
+            case Context::root:
+                context = envelope ? Context::envelope : Context::message;
+                break;
+            case Context::envelope:
+                if(envelopeKey == EnvelopeKey::messages)
+                    return Fail(VirgilDecodeError::WrongType(nullptr, "messages", "an array", "object"));
+                if(envelopeKey == EnvelopeKey::transmittingDevice)
+                    return Fail(VirgilDecodeError::WrongType(nullptr, "transmittingDevice", "a string", "object"));
+                skipDepth = 1;
+                break;
+            case Context::messages:
+                BeginMessage();
+                context = Context::message;
+                break;
+            case Context::message:
+                if(currentKey)
+                    return Fail(TypeError("object"));
+                // Object-valued keys that are not message fields are parameters, if this type has any
+                if(fields.Has(VirgilKey::messageType) && !CarriesParameters(fields.messageType)) {
+                    skipDepth = 1;
+                    break;
+                }
+                BeginParameter();
+                if(ListIsFull(fields.parameters))
+                    return ParameterResult(Fail(VirgilDecodeError::TooManyEntries("parameters", fields.parameters.capacity())));
+                context = Context::parameter;
+                break;
+            case Context::linkedChannels:
+                if(ListIsFull(fields.linkedChannels))
+                    return Fail(VirgilDecodeError::TooManyEntries("linkedChannels", fields.linkedChannels.capacity()));
+                linkedPresent = 0;
+                linkedDeviceName.clear();
+                context = Context::linkedChannel;
+                break;
+            case Context::linkedChannel:
+                if(currentKey)
+                    return Fail(TypeError("object"));
+                skipDepth = 1;
+                break;
+            case Context::parameter:
+                if(currentKey)
+                    return ParameterResult(Fail(TypeError("object")));
+                skipDepth = 1;
+                break;
+            case Context::enumValues:
+                return ParameterResult(Fail(EnumValuesError("object")));
+            case Context::done:
+                break;
+        }
+        return true;
+    }
 
-        // Validate enum parameters according to Virgil protocol requirements
-        if(dataType == "enum") {
-            // Enum value must be stored as VirgilEnum variant
-            if(!std::holds_alternative<VirgilEnum>(value))
-                return false;
-            // The enum itself must be valid (value in enumValues list)
-            VirgilEnum enumVal = std::get<VirgilEnum>(value);
-            if(!enumVal)
-                return false;
+    bool key(std::string& val) {
+        if(skipDepth)
+            return true;
+        if(context == Context::envelope) {
+            envelopeKey = val == "transmittingDevice" ? EnvelopeKey::transmittingDevice : val == "messages" ? EnvelopeKey::messages : EnvelopeKey::other;
+            return true;
         }
-        // Validate numeric parameters (int/float) according to Virgil protocol requirements
-        else if(dataType == "number")
-        {
-            // Numeric value must be stored as int or double variant
-            if(!std::holds_alternative<int>(value) && !std::holds_alternative<double>(value))
-                return false;
+        currentKey = ParseVirgilKey(val);
+        switch(context) {
+            case Context::message:
+                // Keys after linkedChannels belong to parameters and linkedChannels entries
+                if(currentKey && *currentKey > VirgilKey::linkedChannels)
+                    currentKey = std::nullopt;
+                if(!currentKey)
+                    keyName = val;
+                break;
+            case Context::linkedChannel:
+                if(currentKey && *currentKey != VirgilKey::deviceName && *currentKey != VirgilKey::channelIndex && *currentKey != VirgilKey::channelType)
+                    currentKey = std::nullopt;
+                break;
+            case Context::parameter:
+                if(currentKey && *currentKey < VirgilKey::dataType)
+                    currentKey = std::nullopt;
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
 
-            // For non-readonly numeric parameters, Virgil protocol requires minValue, maxValue, and precision
-            // This allows proper validation and UI generation
-            if(!readOnly) {
-                // All three constraint fields are mandatory for editable numeric parameters
-                if(!minValue || !maxValue || !precision)
+    bool end_object() {
+        --depth;
+        if(skipDepth) {
+            --skipDepth;
+            return true;
+        }
+        switch(context) {
+            case Context::message:
+                if(envelope) {
+                    const MessageFactory* factory = Validate();
+                    if(!factory)
+                        return false;
+                    envelope->messages.push_back(factory->fromFieldsPooled(std::move(fields), envelopeOutbound));
+                    context = Context::messages;
+                }
+                else
+                    context = Context::done;
+                break;
+            case Context::envelope:
+                context = Context::done;
+                break;
+            case Context::linkedChannel:
+                if(!FinishLinkedChannel())
                     return false;
+                context = Context::linkedChannels;
+                break;
+            case Context::parameter:
+                context = Context::message;
+                return ParameterResult(FinishParameter());
+            default:
+                break;
+        }
+        return true;
+    }
 
-                // Type consistency check: if value is int, constraints must also be int
-                // This ensures proper type handling in JSON serialization/deserialization
-                if(std::holds_alternative<int>(value)) {
-                    if(!std::holds_alternative<int>(*minValue) || 
-                       !std::holds_alternative<int>(*maxValue) || 
-                       !std::holds_alternative<int>(*precision))
-                        return false;
-                } else if(std::holds_alternative<double>(value)) {
-                    // Similarly for float/double values, all constraints must be float/double
-                    if(!std::holds_alternative<double>(*minValue) || 
-                       !std::holds_alternative<double>(*maxValue) || 
-                       !std::holds_alternative<double>(*precision))
-                        return false;
+    bool start_array(std::size_t) {
+        ++depth;
+        if(skipDepth) {
+            ++skipDepth;
+            return true;
+        }
+        switch(context) {
+            case Context::root:
+                return Fail(VirgilDecodeError::NotAnObject(envelope ? "Virgil envelope" : "Message", "array"));
+            case Context::envelope:
+                if(envelopeKey == EnvelopeKey::messages) {
+                    hasMessages = true;
+                    context = Context::messages;
                 }
+                else if(envelopeKey == EnvelopeKey::transmittingDevice)
+                    return Fail(VirgilDecodeError::WrongType(nullptr, "transmittingDevice", "a string", "array"));
+                else
+                    skipDepth = 1;
+                break;
+            case Context::messages:
+                return Fail(VirgilDecodeError::EntryNotAnObject("messages", envelope->messages.size(), "array"));
+            case Context::message:
+                if(currentKey && *currentKey == VirgilKey::linkedChannels)
+                    context = Context::linkedChannels;
+                else if(currentKey)
+                    return Fail(TypeError("array"));
+                else
+                    skipDepth = 1;
+                break;
+            case Context::parameter:
+                if(currentKey && *currentKey == VirgilKey::enumValues) {
+                    parameter.present |= VirgilKeyBit(VirgilKey::enumValues);
+                    context = Context::enumValues;
+                }
+                else if(currentKey)
+                    return ParameterResult(Fail(TypeError("array")));
+                else
+                    skipDepth = 1;
+                break;
+            case Context::linkedChannel:
+                if(currentKey)
+                    return Fail(TypeError("array"));
+                skipDepth = 1;
+                break;
+            case Context::linkedChannels:
+                return Fail(VirgilDecodeError::EntryNotAnObject("linkedChannels", fields.linkedChannels.size(), "array"));
+            case Context::enumValues:
+                return ParameterResult(Fail(EnumValuesError("array")));
+            case Context::done:
+                break;
+        }
+        return true;
+    }
+
+    bool end_array() {
+        --depth;
+        if(skipDepth) {
+            --skipDepth;
+            return true;
+        }
+        if(context == Context::linkedChannels) {
+            fields.present |= VirgilKeyBit(VirgilKey::linkedChannels);
+            context = Context::message;
+        }
+        else if(context == Context::enumValues)
+            context = Context::parameter;
+        else if(context == Context::messages)
+            context = Context::envelope;
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string& lastToken, const nlohmann::json::exception&) {
+        VirgilDecodeError malformed(VirgilErrorCode::malformedJSON, envelope ? "Virgil envelope" : "Message");
+        malformed.number = position;
+        malformed.input = lastToken;
+        return Fail(malformed);
+    }
+
+private:
+    // Where in the message the parser currently is.
+    enum class Context : uint8_t {
+        root,           // Before the message (or envelope) object
+        envelope,       // Directly inside the envelope object
+        messages,       // Inside the envelope's messages array
+        message,        // Directly inside the message object
+        linkedChannels, // Inside the linkedChannels array
+        linkedChannel,  // Inside one linkedChannels entry
+        parameter,      // Inside a parameter object
+        enumValues,     // Inside a parameter's enumValues array
+        done            // After the message (or envelope) object
+    };
+
+    // Envelope keys. These are not message fields, so they are not part of VirgilKey.
+    enum class EnvelopeKey : uint8_t { other, transmittingDevice, messages };
+
+    // A JSON scalar as reported by the SAX parser.
+    struct Scalar {
+        enum class Kind : uint8_t { null, boolean, integer, bigUnsigned, floating, string } kind = Kind::null;
+        bool boolean = false;
+        int64_t integer = 0;
+        uint64_t bigUnsigned = 0; // Integers above INT64_MAX. Smaller ones are always Kind::integer
+        double floating = 0;
+        std::string* string = nullptr; // Parser-owned buffer. Only valid during the callback; may be moved from.
+
+        bool IsNumber() const {
+            return kind == Kind::integer || kind == Kind::bigUnsigned || kind == Kind::floating;
+        }
+
+        // Type name, matching nlohmann::json::type_name()
+        const char* TypeName() const {
+            switch(kind) {
+                case Kind::boolean: return "boolean";
+                case Kind::integer:
+                case Kind::bigUnsigned:
+                case Kind::floating: return "number";
+                case Kind::string: return "string";
+                default: return "null";
             }
         }
-        // Validate boolean parameters (simple true/false values)
-        else if (dataType == "bool") {
-            // Boolean value must be stored as bool variant
-            if(!std::holds_alternative<bool>(value))
-                return false;
+    };
+
+    // A parameter object that is being read.
+    struct PendingParameter {
+        std::string name;
+        uint32_t present = 0; // VirgilKeyBit() of every parameter field that was found
+        std::optional<ParameterType> dataType; // nullopt if dataType was missing or unknown
+        std::string unknownDataType; // The raw dataType if it is not a known ParameterType, for the error message
+        Scalar value; // If value is a string, it is stored in stringValue instead
+        std::string stringValue;
+        bool readOnly = false;
+        std::string unit;
+        Scalar minValue;
+        Scalar maxValue;
+        Scalar precision;
+        std::vector<std::string> enumValues;
+
+        bool Has(VirgilKey field) const {
+            return (present & VirgilKeyBit(field)) != 0;
         }
-        // Validate string parameters (device names, model info, etc.)
-        else if (dataType == "string") {
-            // String value must be stored as string variant
-            if(!std::holds_alternative<std::string>(value))
-                return false;
+    };
+
+    Context context = Context::root;
+    size_t depth = 0; // Number of objects and arrays that are open
+    size_t skipDepth = 0; // Nesting depth inside a value that is being skipped, or 0
+    size_t parameterDepth = 0; // depth inside the parameter object being read
+    bool tentativeParameter = false; // True if the parameter object being read came before messageType (see ParameterResult())
+    std::optional<VirgilDecodeError> parameterError; // First error in a tentative parameter of the current message
+    std::optional<VirgilKey> currentKey; // Classified key of the value being read, or nullopt if it is not a field of the current object
+    std::string keyName; // Raw key of the value being read, kept only for unknown message-level keys (parameter names)
+    MessageFields fields;
+    VirgilDecodeError error; // Why decoding stopped, once a callback has returned false
+    // linkedChannels entry being read
+    uint32_t linkedPresent = 0;
+    std::string linkedDeviceName;
+    uint64_t linkedChannelIndex = 0;
+    uint64_t linkedChannelType = 0;
+    PendingParameter parameter;
+    // Only used by DecodeEnvelope()
+    VirgilEnvelope* envelope = nullptr;
+    bool envelopeOutbound = false;
+    EnvelopeKey envelopeKey = EnvelopeKey::other;
+    bool hasTransmittingDevice = false;
+    bool hasMessages = false;
+
+    // Records why decoding failed. Returns false so callbacks can `return Fail(...)` to stop the parser.
+    bool Fail(const VirgilDecodeError& failure) {
+        error = failure;
+        return false;
+    }
+
+    // Parses a single message and checks it. Returns its factory, or nullptr with error filled in.
+    const MessageFactory* Parse(std::string_view text) {
+        if(!nlohmann::json::sax_parse(text.data(), text.data() + text.size(), this))
+            return nullptr;
+        return Validate();
+    }
+
+    // Checks that the decoded fields make a valid message of an implemented type. Returns its factory, or nullptr with error filled in.
+    const MessageFactory* Validate() {
+        const MessageFactory* factory = Message::FindFactory(fields, error);
+        if(!factory)
+            return nullptr;
+        // Settle the parameters read before messageType was known
+        if(!CarriesParameters(fields.messageType))
+            fields.parameters.clear();
+        else if(parameterError) {
+            error = *parameterError;
+            return nullptr;
         }
-        else
-            return false; // Unknown/unsupported dataType
-        return true; // All validations passed
+        if(!factory->check(fields, error))
+            return nullptr;
+        return factory;
     }
-};
 
-/**
- * @brief A struct representing a string enumeration with validation for Virgil Protocol parameters.
- * 
- * VirgilEnum is used for parameters that accept only specific predefined string values.
- * This is commonly used for device settings that have discrete options rather than
- * continuous numeric ranges.
- * 
- * 
- * The enum maintains both the current value and the complete list of valid values,
- * enabling proper validation and UI generation (dropdown menus, radio buttons, etc.).
- * 
- * Validation ensures that:
- * - At least one valid value exists in enumValues
- * - The current value is present in the enumValues list
- * - The enum can be safely serialized to/from JSON
- * 
- * @see Virgil Protocol 2.3.0 - "Parameter Structure" for enum parameter requirements
- * @note An empty or invalid enum (where value is not in enumValues) will fail validation
- */
-struct VirgilEnum {
-    std::string value; // Current value
-    std::vector<std::string> enumValues; // List of valid enum values
+    // Passes on the result of a callback made inside a parameter object.
+    // Only some message types carry parameters (see CarriesParameters()), and messageType can come after them. Until it is
+    // known, object-valued keys are read as parameters tentatively: an error is kept for Validate() instead of stopping the
+    // parser, and the rest of the object is skipped. Validate() reports it if the type carries parameters, and otherwise
+    // drops every parameter.
+    bool ParameterResult(bool valid) {
+        if(valid || !tentativeParameter)
+            return valid;
+        if(!parameterError)
+            parameterError = error;
+        // Skip whatever is left of the parameter object, including any arrays or objects open inside it
+        skipDepth = depth >= parameterDepth ? depth - parameterDepth + 1 : 0;
+        context = Context::message;
+        return true;
+    }
 
-    // Default constructor. This will be considered invalid until properly initialized.
-    VirgilEnum() = default;
+    // Builds the error for a known field that received a value of the wrong type.
+    VirgilDecodeError TypeError(const char* received) const {
+        const char* expected = "a string";
+        switch(*currentKey) {
+            case VirgilKey::channelIndex:
+            case VirgilKey::channelType:
+            case VirgilKey::sendingChannelIndex:
+            case VirgilKey::sendingChannelType:
+                expected = "an unsigned integer";
+                break;
+            case VirgilKey::linkedChannels:
+            case VirgilKey::enumValues:
+                expected = "an array";
+                break;
+            case VirgilKey::readOnly:
+                expected = "a boolean";
+                break;
+            case VirgilKey::value:
+                expected = "a scalar";
+                break;
+            case VirgilKey::minValue:
+            case VirgilKey::maxValue:
+            case VirgilKey::precision:
+                expected = "a number";
+                break;
+            default:
+                break;
+        }
+        if(context == Context::parameter)
+            return VirgilDecodeError::WrongType("Parameter", *currentKey, expected, received, parameter.name);
+        return VirgilDecodeError::WrongType(nullptr, *currentKey, expected, received);
+    }
 
-    // Constructor with value and enum values
-    VirgilEnum(std::string val, std::vector<std::string> enumVals)
-    {
-        value = val;
-        enumValues = enumVals;
+    // Builds the error for an enumValues entry that is not a string.
+    VirgilDecodeError EnumValuesError(const char* received) const {
+        return VirgilDecodeError::WrongType("Enum parameter", VirgilKey::enumValues, "an array of strings", received, parameter.name);
     }
 
-    // Validates the VirgilEnum's fields and returns true if valid, false otherwise.
-    // According to Virgil protocol, enums must have at least one valid value and the current value must be in the list
-    operator bool() const {
-        // Must have at least one valid enum value defined
-        if(enumValues.size() < 1)
+    // Reads a string field, moving it out of the parser's buffer.
+    bool TakeString(const Scalar& scalar, std::string& out) {
+        if(scalar.kind != Scalar::Kind::string)
+            return Fail(TypeError(scalar.TypeName()));
+        out = std::move(*scalar.string);
+        return true;
+    }
+
+    // Reads a MessageID field in place.
+    bool GetMessageID(const Scalar& scalar, MessageID& out) {
+        if(scalar.kind != Scalar::Kind::string)
+            return Fail(TypeError(scalar.TypeName()));
+        VirgilResult<MessageID> id = MessageID::TryParse(*scalar.string);
+        if(!id)
+            return Fail(id.Error());
+        out = *id;
+        return true;
+    }
+
+    // Reads an unsigned integer field.
+    bool GetUnsigned(const Scalar& scalar, uint64_t& out) {
+        if(scalar.kind == Scalar::Kind::bigUnsigned) {
+            out = scalar.bigUnsigned; // Range checked by the message, as for any other value
+            return true;
+        }
+        if(scalar.kind != Scalar::Kind::integer || scalar.integer < 0)
+            return Fail(TypeError(scalar.kind == Scalar::Kind::integer ? "negative integer" : scalar.TypeName()));
+        out = static_cast<uint64_t>(scalar.integer);
+        return true;
+    }
+
+    bool Value(Scalar& scalar) {
+        if(skipDepth)
+            return true;
+        switch(context) {
+            case Context::root:
+                return Fail(VirgilDecodeError::NotAnObject(envelope ? "Virgil envelope" : "Message", scalar.TypeName()));
+            case Context::envelope:
+                if(envelopeKey == EnvelopeKey::transmittingDevice) {
+                    if(scalar.kind != Scalar::Kind::string)
+                        return Fail(VirgilDecodeError::WrongType(nullptr, "transmittingDevice", "a string", scalar.TypeName()));
+                    envelope->transmittingDevice = std::move(*scalar.string);
+                    hasTransmittingDevice = true;
+                }
+                else if(envelopeKey == EnvelopeKey::messages)
+                    return Fail(VirgilDecodeError::WrongType(nullptr, "messages", "an array", scalar.TypeName()));
+                return true;
+            case Context::messages:
+                return Fail(VirgilDecodeError::EntryNotAnObject("messages", envelope->messages.size(), scalar.TypeName()));
+            case Context::message:
+                return MessageValue(scalar);
+            case Context::linkedChannels:
+                return Fail(VirgilDecodeError::EntryNotAnObject("linkedChannels", fields.linkedChannels.size(), scalar.TypeName()));
+            case Context::linkedChannel:
+                return LinkedChannelValue(scalar);
+            case Context::parameter:
+                return ParameterResult(ParameterValue(scalar));
+            case Context::enumValues:
+                if(scalar.kind != Scalar::Kind::string)
+                    return ParameterResult(Fail(EnumValuesError(scalar.TypeName())));
+                parameter.enumValues.push_back(std::move(*scalar.string));
+                return true;
+            case Context::done:
+                return true;
+        }
+        return true;
+    }
+
+    bool MessageValue(Scalar& scalar) {
+        // Unknown keys with scalar values are not part of any message
+        if(!currentKey)
+            return true;
+        bool valid = true;
+        switch(*currentKey) {
+            case VirgilKey::messageType: {
+                if(scalar.kind != Scalar::Kind::string)
+                    return Fail(TypeError(scalar.TypeName()));
+                std::optional<MessageType> type = ParseMessageType(*scalar.string);
+                if(!type)
+                    return Fail(VirgilDecodeError::UnknownMessageType(*scalar.string));
+                fields.messageType = *type;
+                break;
+            }
+            case VirgilKey::messageID:
+                valid = GetMessageID(scalar, fields.messageID);
+                break;
+            case VirgilKey::responseID:
+                valid = GetMessageID(scalar, fields.responseID);
+                break;
+            case VirgilKey::channelIndex:
+                valid = GetUnsigned(scalar, fields.channelIndex);
+                break;
+            case VirgilKey::channelType:
+                valid = GetUnsigned(scalar, fields.channelType);
+                break;
+            case VirgilKey::sendingChannelIndex:
+                valid = GetUnsigned(scalar, fields.sendingChannelIndex);
+                break;
+            case VirgilKey::sendingChannelType:
+                valid = GetUnsigned(scalar, fields.sendingChannelType);
+                break;
+            case VirgilKey::errorValue:
+                valid = TakeString(scalar, fields.errorValue);
+                break;
+            case VirgilKey::errorString:
+                valid = TakeString(scalar, fields.errorString);
+                break;
+            default:
+                return Fail(TypeError(scalar.TypeName()));
+        }
+        if(!valid)
             return false;
+        fields.present |= VirgilKeyBit(*currentKey);
+        return true;
+    }
 
-        // Current value must be present in the enumValues list
-        // This ensures the enum is in a valid state per Virgil protocol requirements
-        for(const auto& v : enumValues)
-        {
-            if(v == value)
-                // Exit early when a match is found - enum is valid
+    bool LinkedChannelValue(Scalar& scalar) {
+        if(!currentKey)
+            return true;
+        bool valid = true;
+        switch(*currentKey) {
+            case VirgilKey::deviceName:
+                valid = TakeString(scalar, linkedDeviceName);
+                break;
+            case VirgilKey::channelIndex:
+                valid = GetUnsigned(scalar, linkedChannelIndex);
+                break;
+            case VirgilKey::channelType:
+                valid = GetUnsigned(scalar, linkedChannelType);
+                break;
+            default:
                 return true;
         }
-        return false; // Current value not found in valid values list
+        if(!valid)
+            return false;
+        linkedPresent |= VirgilKeyBit(*currentKey);
+        return true;
     }
 
-    bool operator==(const VirgilEnum& other) const {
-        if(!*this || !other)
-            throw std::invalid_argument("Cannot compare invalid VirgilEnums. Left enum valid=" + std::to_string(static_cast<bool>(*this)) + 
-                " (value='" + value + "'), Right enum valid=" + std::to_string(static_cast<bool>(other)) + 
-                " (value='" + other.value + "')");
-        return value == other.value && enumValues == other.enumValues;
+    bool FinishLinkedChannel() {
+        if(!(linkedPresent & VirgilKeyBit(VirgilKey::deviceName)))
+            return Fail(VirgilDecodeError::MissingField("LinkedChannelInfo", VirgilKey::deviceName));
+        if(linkedDeviceName.empty())
+            return Fail(VirgilDecodeError::InvalidValue("LinkedChannelInfo", VirgilKey::deviceName, {}, "cannot be empty"));
+        if(!DeviceNameFits(linkedDeviceName))
+            return Fail(VirgilDecodeError::InvalidValue("LinkedChannelInfo", VirgilKey::deviceName, linkedDeviceName, "is longer than VIRGIL_MAX_DEVICE_NAME"));
+        if(!MessageFields::CheckChannel(VirgilKey::channelIndex, linkedChannelIndex, VirgilKey::channelType, linkedChannelType, linkedPresent, error))
+            return false;
+        ChannelID channel(static_cast<int>(linkedChannelIndex), static_cast<LinkType>(linkedChannelType));
+        fields.linkedChannels.emplace_back(linkedDeviceName, channel);
+        return true;
     }
 
-    bool operator!=(const VirgilEnum& other) const {
-        return !(*this == other);
+    void BeginParameter() {
+        parameterDepth = depth;
+        tentativeParameter = !fields.Has(VirgilKey::messageType);
+        parameter.name = keyName;
+        parameter.present = 0;
+        parameter.dataType = std::nullopt;
+        parameter.unknownDataType.clear();
+        parameter.value = Scalar{};
+        parameter.stringValue.clear();
+        parameter.readOnly = false;
+        parameter.unit.clear();
+        parameter.minValue = Scalar{};
+        parameter.maxValue = Scalar{};
+        parameter.precision = Scalar{};
+        parameter.enumValues.clear();
+    }
+
+    bool ParameterValue(Scalar& scalar) {
+        if(!currentKey)
+            return true;
+        switch(*currentKey) {
+            case VirgilKey::dataType: {
+                if(scalar.kind != Scalar::Kind::string)
+                    return Fail(TypeError(scalar.TypeName()));
+                parameter.dataType = ParseParameterType(*scalar.string);
+                if(!parameter.dataType)
+                    parameter.unknownDataType = std::move(*scalar.string);
+                break;
+            }
+            case VirgilKey::value:
+                parameter.value = scalar;
+                parameter.value.string = nullptr;
+                if(scalar.kind == Scalar::Kind::string)
+                    parameter.stringValue = std::move(*scalar.string);
+                break;
+            case VirgilKey::readOnly:
+                if(scalar.kind != Scalar::Kind::boolean)
+                    return Fail(TypeError(scalar.TypeName()));
+                parameter.readOnly = scalar.boolean;
+                break;
+            case VirgilKey::unit:
+                if(!TakeString(scalar, parameter.unit))
+                    return false;
+                break;
+            case VirgilKey::minValue:
+            case VirgilKey::maxValue:
+            case VirgilKey::precision: {
+                if(!scalar.IsNumber())
+                    return Fail(TypeError(scalar.TypeName()));
+                Scalar& target = *currentKey == VirgilKey::minValue ? parameter.minValue : *currentKey == VirgilKey::maxValue ? parameter.maxValue : parameter.precision;
+                target = scalar;
+                break;
+            }
+            default:
+                return Fail(TypeError(scalar.TypeName()));
+        }
+        parameter.present |= VirgilKeyBit(*currentKey);
+        return true;
+    }
+
+    // Reads a numeric parameter field. int fields must be integers that fit an int, and float fields numbers that fit a float.
+    template <class T>
+    bool GetNumber(const Scalar& scalar, VirgilKey field, T& out) {
+        if(!scalar.IsNumber())
+            return Fail(VirgilDecodeError::WrongType("Parameter", field, "a number", scalar.TypeName(), parameter.name));
+        if constexpr (std::is_same_v<T, int>) {
+            if(scalar.kind == Scalar::Kind::floating)
+                return Fail(VirgilDecodeError::WrongType("Integer parameter", field, "an integer", "floating-point number", parameter.name));
+            if(scalar.kind == Scalar::Kind::bigUnsigned)
+                return Fail(VirgilDecodeError::OutOfRange("Integer parameter", field, std::to_string(scalar.bigUnsigned), "between -2147483648 and 2147483647", parameter.name));
+            if(scalar.integer < INT_MIN || scalar.integer > INT_MAX)
+                return Fail(VirgilDecodeError::OutOfRange("Integer parameter", field, VirgilDecodeError::Excerpt::Number(scalar.integer), "between -2147483648 and 2147483647", parameter.name));
+            out = static_cast<int>(scalar.integer);
+        }
+        else {
+            double value = scalar.kind == Scalar::Kind::integer ? static_cast<double>(scalar.integer) : 
+                scalar.kind == Scalar::Kind::bigUnsigned ? static_cast<double>(scalar.bigUnsigned) : scalar.floating;
+            if(std::fabs(value) > FLT_MAX)
+                return Fail(VirgilDecodeError::OutOfRange("Float parameter", field, VirgilDecodeError::Excerpt::Number(value), "within the range of a float", parameter.name));
+            out = static_cast<float>(value);
+        }
+        return true;
     }
 
+    template <class T>
+    bool GetOptionalNumber(VirgilKey field, const Scalar& scalar, std::optional<T>& out) {
+        if(!parameter.Has(field))
+            return true;
+        return GetNumber(scalar, field, out.emplace());
+    }
+
+    // Builds an int or float parameter, after the same checks its constructor makes.
+    template <class T>
+    bool FinishNumberParameter(const char* owner) {
+        const std::string& name = parameter.name;
+        if(!parameter.Has(VirgilKey::unit))
+            return Fail(VirgilDecodeError::MissingField(owner, VirgilKey::unit, name));
+        T value;
+        std::optional<T> minVal, maxVal, prec;
+        if(!GetNumber(parameter.value, VirgilKey::value, value) ||
+            !GetOptionalNumber(VirgilKey::minValue, parameter.minValue, minVal) ||
+            !GetOptionalNumber(VirgilKey::maxValue, parameter.maxValue, maxVal) ||
+            !GetOptionalNumber(VirgilKey::precision, parameter.precision, prec))
+            return false;
+        if(!Parameter::CheckNumber(name, value, parameter.readOnly, parameter.unit, minVal, maxVal, prec, error))
+            return false;
+        fields.parameters.emplace_back(ParameterName::Decoded(name), value, parameter.readOnly, parameter.unit, minVal, maxVal, prec);
+        return true;
+    }
+
+    bool FinishParameter() {
+        const std::string& name = parameter.name;
+        if(!Parameter::CheckName(name, error))
+            return false;
+        if(!parameter.Has(VirgilKey::dataType))
+            return Fail(VirgilDecodeError::MissingField("Parameter", VirgilKey::dataType, name));
+        if(!parameter.Has(VirgilKey::value))
+            return Fail(VirgilDecodeError::MissingField("Parameter", VirgilKey::value, name));
+        if(!parameter.Has(VirgilKey::readOnly))
+            return Fail(VirgilDecodeError::MissingField("Parameter", VirgilKey::readOnly, name));
+
+        if(!parameter.dataType)
+            return Fail(VirgilDecodeError::UnknownDataType(name, parameter.unknownDataType));
+
+        switch(*parameter.dataType) {
+            case ParameterType::string:
+            case ParameterType::enumeration:
+                if(parameter.value.kind != Scalar::Kind::string)
+                    return Fail(VirgilDecodeError::WrongType("Parameter", VirgilKey::value, "a string", parameter.value.TypeName(), name));
+                if(*parameter.dataType == ParameterType::string)
+                    fields.parameters.emplace_back(ParameterName::Decoded(name), parameter.stringValue, parameter.readOnly);
+                else {
+                    if(!parameter.Has(VirgilKey::enumValues))
+                        return Fail(VirgilDecodeError::MissingField("Enum parameter", VirgilKey::enumValues, name));
+                    VirgilEnum enumValue(parameter.stringValue, parameter.enumValues);
+                    if(!enumValue)
+                        return Fail(VirgilDecodeError::InvalidValue("Enum parameter", std::nullopt, parameter.stringValue,
+                            "is not in its enumValues list", name));
+                    fields.parameters.emplace_back(ParameterName::Decoded(name), enumValue, parameter.readOnly);
+                }
+                return true;
+            case ParameterType::boolean:
+                if(parameter.value.kind != Scalar::Kind::boolean)
+                    return Fail(VirgilDecodeError::WrongType("Parameter", VirgilKey::value, "a boolean", parameter.value.TypeName(), name));
+                fields.parameters.emplace_back(ParameterName::Decoded(name), parameter.value.boolean, parameter.readOnly);
+                return true;
+            case ParameterType::integer:
+                return FinishNumberParameter<int>("Integer parameter");
+            case ParameterType::floating:
+                return FinishNumberParameter<float>("Float parameter");
+        }
+        return true;
+    }
+
+    // Resets the per-message state before the next message of an envelope.
+    void BeginMessage() {
+        fields = MessageFields{};
+        currentKey = std::nullopt;
+        parameterError = std::nullopt;
+    }
 };
 
 /**
- * @brief A struct representing a unique channel identifier in the Virgil Protocol 2.3.0.
- * 
- * ChannelID combines a channel index (0-based) with a channel type to uniquely identify
- * any channel within the Virgil audio network. This identifier is used throughout the
- * protocol for routing audio, managing parameters, and establishing device connections.
+ * @brief Splits a TCP byte stream into complete Virgil envelopes.
  * 
- * Channel Type Meanings:
- * - TX (0): Dante transmitting channels that send audio data to other devices
- * - RX (1): Dante receiving channels that receive audio data from other devices  
- * - AUX (2): Auxiliary channels for non-Dante device control (e.g., wall panels, dials)
+ * TCP delivers a Virgil connection as an arbitrary sequence of chunks: one read can hold half an
+ * envelope, or several envelopes and the start of the next. Feed every chunk to the framer (or
+ * read straight into Prepare()/Commit()), then call Next() until it returns false.
  * 
- * Usage Patterns:
- * - Audio routing: TX channels link to RX channels to establish audio flow
- * - Parameter control: Each channel can have device-specific parameters (gain, phantom power, etc.)
- * - Device discovery: Enumerate all channels during connection establishment
- * - Status monitoring: Subscribe to parameter changes on specific channels
+ * The framer tracks object depth, strings and escapes incrementally, so every byte is scanned
+ * exactly once no matter how many reads an envelope is split across. Envelopes are returned as
+ * views into the framer's buffer and can be passed to MessageDecoder::DecodeEnvelope() without
+ * copying. Consumed bytes are reclaimed by moving the unread tail to the front of the buffer once
+ * it is at least half consumed, so the buffer stops growing once it fits the largest envelope.
  * 
- * Linking Rules:
- * - TX <-> RX: Bidirectional linking for audio flow (either side can initiate)
- * - AUX -> Device: AUX channels link to devices, not other channels. The device with the aux channel cannot initiate.
- * - Channel indices start at 0 and must correspond to actual device capabilities
+ * Whitespace between envelopes is skipped. Anything else outside an envelope is a protocol error.
  * 
- * JSON Serialization:
- * - Standard fields: "channelIndex" and "channelType" 
- * - Custom fields: Allow flexible field naming for different message contexts
+ * @note Not thread-safe. Use one framer per connection
  * 
- * @see Virgil Protocol 2.3.0 - "Channel Types" and "Linking Channels" sections
- * @note Every Dante channel must have a corresponding Virgil channel with appropriate type
+ * @example
+ * ```cpp
+ * StreamFramer framer;
+ * char* dest = framer.Prepare(4096);
+ * framer.Commit(recv(sock, dest, 4096, 0));
+ * std::string_view text;
+ * while(framer.Next(text)) {
+ *     VirgilEnvelope envelope = MessageDecoder::DecodeEnvelope(text, false);
+ *     // ...
+ * }
+ * ```
  */
-struct ChannelID {
-    uint16_t channelIndex; // Index of the channel
-    LinkType channelType; // Type of the channel, e.g. "aux", "tx", "rx", "device"
-
-    ChannelID() : channelIndex(0), channelType(LinkType::tx) {}
-
-    // Constructor for when both channel index and type are provided
-    ChannelID(const int index, const LinkType type)
-    {
-        if(index < 0)
-            throw std::invalid_argument("Channel index (" + std::to_string(index) + ") cannot be negative. Valid range is 0 and above.");
-        channelType = type;
-        channelIndex = index;
-    }
-
-    // Scans a JSON object for channelIndex and channelType, and constructs a ChannelID.
-    ChannelID(const nlohmann::json& j) : ChannelID(j, "channelIndex", "channelType") {}
-
-    // Scans a JSON object for channelIndex and channelType with custom field names, and constructs a ChannelID.
-    ChannelID(const nlohmann::json& j, const std::string& channelindexName, const std::string& channelTypeName) {
-        if(!j.contains(channelTypeName))
-            throw std::invalid_argument("ChannelID JSON must contain field '" + channelTypeName + "'. Available fields: " + 
-                [&j]() {
-                    std::string fields = "";
-                    for (auto it = j.begin(); it != j.end(); ++it) {
-                        if (!fields.empty()) fields += ", ";
-                        fields += "'" + it.key() + "'";
-                    }
-                    return fields.empty() ? "(none)" : fields;
-                }());
-        
-        if(!j.at(channelTypeName).is_number_unsigned())
-            throw std::invalid_argument("Field '" + channelTypeName + "' must be an unsigned integer, but received type: " + 
-                std::string(j.at(channelTypeName).type_name()) + " with value: " + j.at(channelTypeName).dump());
-            
-        channelType = static_cast<LinkType>(j.at(channelTypeName).get<uint8_t>());
-
-        if(!j.contains(channelindexName))
-            throw std::invalid_argument("ChannelID JSON must contain field '" + channelindexName + "'. Available fields: " + 
-                [&j]() {
-                    std::string fields = "";
-                    for (auto it = j.begin(); it != j.end(); ++it) {
-                        if (!fields.empty()) fields += ", ";
-                        fields += "'" + it.key() + "'";
-                    }
-                    return fields.empty() ? "(none)" : fields;
-                }());
-        
-        if(!j.at(channelindexName).is_number_unsigned())
-            throw std::invalid_argument("Field '" + channelindexName + "' must be an unsigned integer, but received type: " + 
-                std::string(j.at(channelindexName).type_name()) + " with value: " + j.at(channelindexName).dump());
+class StreamFramer {
+public:
+    static constexpr size_t DefaultMaxEnvelopeSize = 16 * 1024 * 1024; ///< Default limit on the size of one envelope, in bytes
 
-        channelIndex = j.at(channelindexName).get<uint16_t>();
-    }
+    /// @brief Constructs an empty framer.
+    /// @param maxEnvelopeSize Largest envelope accepted, in bytes. Guards against a peer that never closes its envelope.
+    explicit StreamFramer(size_t maxEnvelopeSize = DefaultMaxEnvelopeSize) : maxSize(maxEnvelopeSize) {}
 
-    // Converts the ChannelID to a JSON object with field names of "channelIndex" and "channelType".
-    // @return A JSON object containing only "channelIndex" and "channelType" fields if they are set.
-    nlohmann::json to_json() const {
-        return to_json("channelIndex", "channelType");
+    /// @brief Appends received bytes to the framer.
+    /// Invalidates views returned by Next().
+    void Feed(std::string_view data) {
+        if(data.empty())
+            return;
+        std::memcpy(Reserve(data.size()), data.data(), data.size());
+        Commit(data.size());
     }
 
-    // Converts the ChannelID to a JSON object with custom field names.
-    // @param channelindexName The field name to store the channel index in.
-    // @param channelTypeName The field name to store the channel type in.
-    // @return A JSON object containing only the specified fields if they are set.
-    nlohmann::json to_json(const std::string& channelindexName, const std::string& channelTypeName) const {
-        nlohmann::json j;
-        j[channelindexName] = channelIndex;
-        j[channelTypeName] = channelType;
-        return j;
+    /// @brief Returns space for at least size bytes to be received into directly, avoiding a copy.
+    /// Call Commit() with the number of bytes actually written. Invalidates views returned by Next().
+    /// @throws std::invalid_argument if size is larger than the envelope size limit
+    char* Prepare(size_t size) {
+        if(size > maxSize)
+            VirgilThrowInvalidArgument("Cannot prepare " + std::to_string(size) + " bytes, the envelope size limit is " + std::to_string(maxSize));
+        return Reserve(size);
     }
 
-    // Appends the ChannelID fields to an existing JSON object with custom field names.
-    // @param j The JSON object to append to. It does not clear existing fields, but will overwrite the fields if they already exist.
-    // @param channelindexName The field name to store the channel index in.
-    // @param channelTypeName The field name to store the channel type in.
-    void AppendJson(nlohmann::json& j, const std::string& channelindexName, const std::string& channelTypeName) const {
-        j[channelindexName] = channelIndex;
-        j[channelTypeName] = channelType;
+    /// @brief Marks size bytes written to the space returned by Prepare() as received.
+    void Commit(size_t size) {
+        end += std::min(size, buffer.size() - end);
     }
 
-    // Appends the ChannelID fields to an existing JSON object with field names of "channelIndex" and "channelType".
-    // @param j The JSON object to append to. It does not clear existing fields, but will overwrite the fields if they already exist.
-    void AppendJson(nlohmann::json& j) const {
-        AppendJson(j, "channelIndex", "channelType");
-    }
+    /**
+     * @brief Finds the next complete envelope.
+     * 
+     * @param envelope Set to the JSON text of the envelope. The view stays valid until the next call
+     *        to Feed(), Prepare() or Reset().
+     * @return True if a complete envelope was found, false if more bytes are needed
+     * @throws std::invalid_argument if a byte outside an envelope is not whitespace or '{', or an envelope
+     *         grows past the size limit. The framer is reset; the connection should be closed.
+     */
+    bool Next(std::string_view& envelope) {
+        const char* data = buffer.data();
+        size_t i = scanned;
+        if(depth == 0) {
+            // Between envelopes: skip whitespace and find the opening brace
+            while(i < end && IsWhitespace(data[i]))
+                ++i;
+            begin = scanned = i;
+            if(i == end)
+                return false;
+            if(data[i] != '{') {
+                VirgilDecodeError error(VirgilErrorCode::malformedJSON, "Virgil stream");
+                error.input = std::string_view(data + i, 1);
+                Reset();
+                VirgilThrowDecodeError(error);
+            }
+        }
 
+        // Scan no further than the size limit allows, so an envelope is never returned past it
+        const size_t limit = end - begin > maxSize ? begin + maxSize : end;
+        while(i < limit) {
+            if(inString) {
+                if(escaped)
+                    escaped = false;
+                else {
+                    // Jump to the next character that can end the string
+                    while(i < limit && data[i] != '"' && data[i] != '\\')
+                        ++i;
+                    if(i == limit)
+                        break;
+                    if(data[i] == '\\')
+                        escaped = true;
+                    else
+                        inString = false;
+                }
+            }
+            else if(data[i] == '"')
+                inString = true;
+            else if(data[i] == '{')
+                ++depth;
+            else if(data[i] == '}' && --depth == 0) {
+                envelope = std::string_view(data + begin, i + 1 - begin);
+                begin = scanned = i + 1;
+                return true;
+            }
+            ++i;
+        }
+        scanned = i;
 
-    // Checks if the channel is an auxiliary channel.
-    bool IsAux() const {
-        return channelType == LinkType::aux;
+        if(limit != end) {
+            Reset();
+            VirgilDecodeError error(VirgilErrorCode::tooLarge, "Virgil envelope");
+            error.number = maxSize;
+            VirgilThrowDecodeError(error);
+        }
+        return false;
     }
 
-    // Checks if the channel is a transmit channel.
-    bool IsTx() const {
-        return channelType == LinkType::tx;
+    /// @brief Gets the number of received bytes that have not been returned by Next() yet.
+    size_t Buffered() const {
+        return end - begin;
     }
 
-    // Checks if the channel is a receive channel.
-    bool IsRx() const {
-        return channelType == LinkType::rx;
+    /// @brief Discards all buffered bytes, e.g. after reconnecting. Keeps the buffer's memory.
+    void Reset() {
+        begin = scanned = end = 0;
+        depth = 0;
+        inString = escaped = false;
     }
 
-    // Gets the index of the channel.
-    // @return The channel index.
-    // @throws std::runtime_error if the channel is device-level (no index) or if the index is not set.
-    int GetIndex() const {
-        return channelIndex;
+private:
+    std::vector<char> buffer;
+    size_t begin = 0;   // Start of the envelope being scanned (everything before it has been returned)
+    size_t scanned = 0; // Bytes before this have been scanned
+    size_t end = 0;     // End of the received bytes
+    size_t maxSize;
+    // Scanner state at `scanned`
+    size_t depth = 0;
+    bool inString = false;
+    bool escaped = false;
+
+    static bool IsWhitespace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
     }
 
-    bool operator==(const ChannelID& other) const {
-        return channelIndex == other.channelIndex && channelType == other.channelType;
+    // Returns space for at least size bytes after the received ones.
+    char* Reserve(size_t size) {
+        Compact();
+        if(buffer.size() - end < size)
+            buffer.resize(end + size);
+        return buffer.data() + end;
     }
-    bool operator!=(const ChannelID& other) const {
-        return !(*this == other);
+
+    // Moves the unreturned bytes to the front once at least half the buffer has been returned.
+    void Compact() {
+        if(begin == 0 || (begin != end && begin < buffer.size() / 2))
+            return;
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        scanned -= begin;
+        end -= begin;
+        begin = 0;
     }
 };
 
 /**
- * @brief Enumeration representing the three types of channels in the Virgil Protocol 2.3.0.
- * 
- * The Virgil protocol defines three distinct channel types that correspond to different
- * audio routing and device control scenarios:
- * 
- * - TX channels (0): Dante transmitting channels that send audio data
- * - RX channels (1): Dante receiving channels that receive audio data  
- * - AUX channels (2): Auxiliary non-Dante channels for accessory control
- * 
- * Channel linking rules:
- * - TX channels can only link to RX channels and vice versa
- * - AUX channels link to devices rather than other channels
- * - Every Dante channel must have a corresponding Virgil channel
+ * @brief Packs many messages into Virgil envelopes, flushing each envelope as one packet.
  * 
- * For example, a device with 12 Dante transmitting channels and 8 Dante receiving
- * channels would advertise 12 TX channels and 8 RX channels in Virgil.
- * 
- * @see Virgil Protocol 2.3.0 - "Channel Types" section
- * @note Channel indices start at 0 for all types
- */
-enum class LinkType : uint8_t {
-    tx = 0,   ///< Transmit channels - Dante transmitting channels that send audio data
-    rx = 1,   ///< Receive channels - Dante receiving channels that receive audio data  
-    aux = 2   ///< Auxiliary channels - Non-Dante accessory channels (e.g., in-wall dials)
-};
-
-// Currently Unused, being implimented
-enum class VirgilError : uint8_t {
-    UnrecognizedCommand = 0
-    ValueOutOfRange = 1
-    InvalidValueType = 2
-    UnableToChangeValue = 3
-    DeviceNotFound = 4
-    ChannelIndexInvalid = 5
-    ParameterReadOnly = 6
-    ParameterUnsupported = 7
-    MalformedMessage = 8
-    Busy = 9
-    Timeout = 10
-    PermissionDenied = 11
-    InternalError = 12
-    OutOfResources = 13
-    NetworkError = 14
-    Custom = 255
-}
-
-/**
- * @brief A struct representing linked channel information for the mandatory linkedChannels parameter.
+ * The protocol lets one envelope carry any number of messages in its messages array. Sending
+ * fifty status updates as one packet instead of fifty saves a syscall and a TCP segment for each.
  * 
- * LinkedChannelInfo describes a connection between the current channel and a channel on another
- * device in the Virgil audio network. This information is stored in the mandatory "linkedChannels"
- * parameter and represents the actual audio flow established via Dante networking.
+ * Messages are serialized straight into one preallocated buffer that already holds the envelope
+ * header. The envelope is handed to the flush handler, and the buffer reused, when:
+ * - it holds maxMessages messages, or
+ * - adding another message would make it larger than maxBytes. The message that did not fit starts the next envelope
+ * - Flush() is called, e.g. at the end of a processing loop or on a timer
  * 
- * The structure varies based on channel type:
+ * A single message larger than maxBytes is still sent, alone in its own envelope.
  * 
- * **For TX/RX Channels** (audio flow):
- * ```json
- * {
- *   "deviceName": "ConnectedDeviceName",
- *   "channelIndex": 0,
- *   "channelType": 1
- * }
- * ```
+ * @note Messages that are still buffered are not sent when the writer is destroyed. Call Flush() first
  * 
- * **For AUX Channels** (device control):
- * ```json
- * {
- *   "deviceName": "ConnectedDeviceName"
- *   // No channelIndex/channelType - AUX links to device, not specific channel
- * }
+ * @example
+ * ```cpp
+ * EnvelopeWriter writer("Mixer 1", [&](std::string_view packet) {
+ *     send(sock, packet.data(), packet.size(), 0);
+ * });
+ * for (const Message* msg : updates)
+ *     writer.Add(*msg);
+ * writer.Flush();
  * ```
- * 
- * Protocol Requirements:
- * - linkedChannels array starts empty and is populated as connections are made
- * - TX channels can link to multiple RX channels (one-to-many audio distribution)
- * - RX channels typically link to one TX channel (audio source)
- * - AUX channels link to devices for control purposes
- * - If channels are subscribed in Dante, they must be linked in Virgil
- * 
- * This information enables:
- * - Audio routing visualization and management
- * - Automatic parameter subscription management  
- * - Network topology discovery and validation
- * - Conflict detection and resolution
- * 
- * @see Virgil Protocol 2.3.0 - "Parameters" section for linkedChannels specification
- * @see ChannelID for channel identification details
  */
-struct LinkedChannelInfo {
-    std::string deviceName;
-    ChannelID channel;
+class EnvelopeWriter {
+public:
+    /// @brief Called with the text of each complete envelope. The view is only valid during the call.
+    using FlushHandler = std::function<void(std::string_view packet)>;
 
-    // Default constructor. Will be considered invalid until properly initialized.
-    LinkedChannelInfo() = default;
+    static constexpr size_t DefaultMaxBytes = 64 * 1024; ///< Default size limit of one envelope, in bytes
+    static constexpr size_t DefaultMaxMessages = 64; ///< Default message limit of one envelope
 
-    // Constructor with device name and channel
-    LinkedChannelInfo(const std::string& devName, const ChannelID& chan) : deviceName(devName), channel(chan) {
-        if(devName.empty())
-            throw std::invalid_argument("LinkedChannelInfo device name cannot be empty. Channel info: type=" + 
-                std::to_string(static_cast<int>(chan.channelType)) + ", index=" + std::to_string(chan.channelIndex));
+    /**
+     * @brief Constructs a writer for envelopes sent by the given device.
+     * 
+     * @param transmittingDevice The name of this device, written to every envelope
+     * @param onFlush Called with each complete envelope
+     * @param maxBytes Largest envelope to build, in bytes. The buffer is preallocated to this size.
+     * @param maxMessages Most messages to put in one envelope
+     * @throws std::invalid_argument if maxMessages is 0
+     */
+    EnvelopeWriter(std::string_view transmittingDevice, FlushHandler onFlush, 
+        size_t maxBytes = DefaultMaxBytes, size_t maxMessages = DefaultMaxMessages)
+        : handler(std::move(onFlush)), byteLimit(maxBytes), messageLimit(maxMessages) {
+        if(maxMessages == 0)
+            VirgilThrowInvalidArgument("EnvelopeWriter maxMessages must be at least 1");
+        buffer.reserve(maxBytes);
+        JsonWriter writer(buffer);
+        writer.BeginObject();
+        writer.Key("transmittingDevice");
+        writer.String(transmittingDevice);
+        writer.Key("messages");
+        writer.BeginArray();
+        headerSize = buffer.size();
     }
 
-    // Constructor from JSON
-    LinkedChannelInfo(const nlohmann::json& j) {
-        // Checks for deviceName field
-        if(!j.contains("deviceName"))
-            throw std::invalid_argument("LinkedChannelInfo JSON must contain 'deviceName' field. Available fields: " + 
-                [&j]() {
-                    std::string fields = "";
-                    for (auto it = j.begin(); it != j.end(); ++it) {
-                        if (!fields.empty()) fields += ", ";
-                        fields += "'" + it.key() + "'";
-                    }
-                    return fields.empty() ? "(none)" : fields;
-                }());
-        
-        std::string devName = j.at("deviceName").get<std::string>();
-        if(devName.empty())
-            throw std::invalid_argument("LinkedChannelInfo 'deviceName' field cannot be empty");
-        deviceName = devName;
+    /**
+     * @brief Adds a message to the current envelope, flushing first or afterwards if a limit is reached.
+     * 
+     * @param message The message to send
+     * @throws std::invalid_argument if the message cannot be serialized. The envelope is left as it was.
+     * @throws Whatever the flush handler throws
+     */
+    void Add(const Message& message) {
+        size_t mark = buffer.size();
+        if(count)
+            buffer.push_back(',');
+        VIRGIL_TRY {
+            message.append_to(buffer);
+        } VIRGIL_CATCH_ALL {
+            buffer.resize(mark);
+            VIRGIL_RETHROW;
+        }
 
-        // Creates ChannelID from JSON
-        channel = ChannelID(j);
+        if(count && buffer.size() + ClosingSize > byteLimit) {
+            // Did not fit: send the envelope without it, then start the next envelope with it
+            spill.assign(buffer, mark + 1, std::string::npos);
+            buffer.resize(mark);
+            Flush();
+            buffer.append(spill);
+        }
+        ++count;
+        if(count >= messageLimit || buffer.size() + ClosingSize >= byteLimit)
+            Flush();
+    }
 
-        // Checks validity
-        if(!*this)
-            throw std::invalid_argument("Invalid LinkedChannelInfo: deviceName='" + deviceName + 
-                "', channelType=" + std::to_string(static_cast<int>(channel.channelType)) + 
-                ", channelIndex=" + std::to_string(channel.channelIndex));
+    /// @brief Sends the current envelope to the flush handler, if it holds any messages.
+    /// The writer is empty afterwards, even if the handler throws.
+    void Flush() {
+        if(!count)
+            return;
+        buffer.append("]}");
+        VIRGIL_TRY {
+            handler(std::string_view(buffer));
+        } VIRGIL_CATCH_ALL {
+            Discard();
+            VIRGIL_RETHROW;
+        }
+        Discard();
     }
 
-    nlohmann::json to_json() const {
-        if(!*this)
-            throw std::invalid_argument("Cannot convert invalid LinkedChannelInfo to JSON. DeviceName='" + deviceName + 
-                "', channelType=" + std::to_string(static_cast<int>(channel.channelType)) + 
-                ", channelIndex=" + std::to_string(channel.channelIndex));
-        nlohmann::json j;
-        j["deviceName"] = deviceName;
-        channel.AppendJson(j);
-        return j;
+    /// @brief Drops the messages in the current envelope without sending them.
+    void Discard() {
+        buffer.resize(headerSize);
+        count = 0;
     }
 
-    operator bool() const {
-        return !deviceName.empty();
+    /// @brief Gets the number of messages in the current envelope.
+    size_t MessageCount() const {
+        return count;
+    }
+
+    /// @brief Gets the size of the current envelope in bytes, including the closing brackets.
+    size_t Size() const {
+        return buffer.size() + ClosingSize;
     }
+
+private:
+    static constexpr size_t ClosingSize = 2; // "]}"
+
+    FlushHandler handler;
+    size_t byteLimit;
+    size_t messageLimit;
+    std::string buffer; // Envelope header followed by the serialized messages
+    std::string spill;  // Holds a message that did not fit while the envelope before it is flushed
+    size_t headerSize = 0;
+    size_t count = 0;
 };
 
+
 /**
- * @brief A struct representing a unique message identifier for Virgil Protocol 2.3.0 messages.
- * 
- * MessageID provides unique identification for every message in the Virgil protocol, enabling
- * proper request-response correlation, logging, and debugging. The ID combines timestamp 
- * information with a sequence counter to ensure uniqueness even under high message rates.
- * 
- * **Format**: 12-digit string "HHMMSSmmm###"
- * - **HH**: Hour in 24-hour format (00-23)
- * - **MM**: Minute (00-59)
- * - **SS**: Second (00-59)  
- * - **mmm**: Millisecond (000-999)
- * - **###**: Message index within the same millisecond (000-999)
+ * @brief Matches inbound responses to the outstanding requests that caused them.
  * 
- * **Example**: "143052847000" = 14:30:52.847 (2:30:52.847 PM), message #0 in that millisecond
+ * Register a handler when sending a request, then pass every inbound message to Dispatch().
+ * Messages whose responseID names a pending request are handed to that request's handler:
+ * - InfoResponse, ErrorResponse and any other response are delivered with complete = false
+ * - EndResponse is delivered with complete = true, after which the request is removed
  * 
- * **Usage Patterns**:
- * - Every message must have a unique messageID
- * - Response messages include responseID referencing the original request's messageID
- * - endResponse messages should NOT include responseID when ending sessions
- * - statusUpdate messages include responseID only when responding to specific requests
+ * Requests are stored in an open-addressing hash table (linear probing, keyed by PackedMessageID),
+ * so registering, dispatching and removing are O(1) regardless of how many requests are outstanding.
+ * The table grows when it becomes half full and never shrinks, except through Clear().
  * 
- * **Implementation Notes**:
- * - Timestamps use local device time (devices may not be synchronized)
- * - Not recommended for precise timing - use only for logging and correlation
- * - Auto-generation ensures uniqueness within a single device
- * - Particularly important for AUX devices not connected via Dante
+ * Handlers may add or remove requests, including their own, while being called.
  * 
- * **Thread Safety**: 
- * - GenerateNew() uses static counters and should be called from a single thread
- * - Multiple simultaneous calls may need synchronization depending on implementation
+ * @note Not thread-safe. Use one table per connection, or guard it with a lock
+ * @see MessageID::Pack() for the key format
  * 
- * @see Virgil Protocol 2.3.0 - "Message ID" section for complete specification
- * @note Do not use for anything beyond logging - device timestamps may not be synchronized
+ * @example
+ * ```cpp
+ * PendingRequests pending;
+ * InfoRequest request(...);
+ * request.selfID = MessageID::GenerateNew();
+ * pending.Add(request.selfID, [](const Message& response, bool complete) {
+ *     // Handle InfoResponse / ErrorResponse, then EndResponse with complete = true
+ * });
+ * // For every received message:
+ * if(!pending.Dispatch(*msg)) { ... } // Not a response to one of our requests
+ * ```
  */
-struct MessageID {
-    static std::chrono::system_clock::time_point timeLastSent; ///< Timestamp of the last generated message (for uniqueness)
-    static uint16_t currentMessageIndex; ///< Counter for messages within the same millisecond
+class PendingRequests {
+public:
+    /// @brief Called for each response to a request. complete is true for the EndResponse that finishes it.
+    using Handler = std::function<void(const Message& response, bool complete)>;
 
-    static MessageID GenerateNew() {
-        std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+    /// @brief Constructs an empty table sized for the given number of outstanding requests.
+    explicit PendingRequests(size_t expectedRequests = 16) {
+        size_t capacity = MinCapacity;
+        while (capacity < expectedRequests * 2)
+            capacity *= 2;
+        slots.resize(capacity);
+    }
 
-        if (now == timeLastSent) {
-            currentMessageIndex++;
-        } else {
-            currentMessageIndex = 0;
-            timeLastSent = now;
-        }
-        MessageID newId;
-        newId.timeSent = now;
-        newId.messageIndex = currentMessageIndex;
-        return newId;
+    /// @brief Registers a handler for responses to the given request.
+    /// @throws std::invalid_argument if requestID or handler is empty, or a request with the same ID is already pending
+    void Add(const MessageID& requestID, Handler handler) {
+        if (!requestID)
+            VirgilThrowInvalidArgument("PendingRequests cannot register a request with an empty MessageID");
+        Add(requestID.Pack(), std::move(handler));
     }
 
-    // Time the message was sent (system_clock::time_point)
-    std::chrono::system_clock::time_point timeSent{}; ///< Absolute timestamp when message was created
-    // Index of the message within the same millisecond (0-999).
-    uint16_t messageIndex = 0; ///< Sequence number for messages sent in the same millisecond
+    /// @brief Registers a handler for responses to the request with the given packed ID.
+    /// @throws std::invalid_argument if handler is empty or a request with the same ID is already pending
+    void Add(PackedMessageID requestID, Handler handler) {
+        if (!handler)
+            VirgilThrowInvalidArgument("PendingRequests cannot register an empty handler");
+        if ((count + 1) * 2 > slots.size())
+            Rehash(slots.size() * 2);
+        size_t i = Probe(requestID.value);
+        if (slots[i].key == requestID.value)
+            VirgilThrowInvalidArgument("PendingRequests already has a pending request with MessageID '" +
+                MessageID(requestID).to_string() + "'");
+        slots[i].key = requestID.value;
+        slots[i].handler = std::move(handler);
+        ++count;
+    }
 
-    // Default constructor
-    MessageID() = default; 
- 
-    /// @brief Constructor from format provided in virgil messages
-    /// @param id A 12-digit string in the format HHMMSSmmm### where HH is hours, MM is minutes, SS is seconds, mmm is milliseconds, and ### is the message index.
-    MessageID(const std::string& id) {
-        if (id.length() != 12)
-            throw std::invalid_argument("MessageID string must be exactly 12 digits, but received '" + id + 
-                "' which has " + std::to_string(id.length()) + " characters. Expected format: HHMMSSmmm###");
+    /// @brief Removes a pending request without calling its handler, e.g. on timeout.
+    /// @return True if the request was pending
+    bool Remove(const MessageID& requestID) {
+        return requestID && Remove(requestID.Pack());
+    }
 
-        // Validate that all characters are digits
-        for (size_t i = 0; i < id.length(); ++i) {
-            if (!std::isdigit(id[i])) {
-                throw std::invalid_argument("MessageID string '" + id + "' contains non-digit character '" + 
-                    id[i] + "' at position " + std::to_string(i) + ". All characters must be digits 0-9.");
-            }
+    /// @brief Removes a pending request without calling its handler, e.g. on timeout.
+    /// @return True if the request was pending
+    bool Remove(PackedMessageID requestID) {
+        size_t i = Probe(requestID.value);
+        if (slots[i].key != requestID.value)
+            return false;
+        Erase(i);
+        return true;
+    }
+
+    /// @brief Checks if a request is pending.
+    bool Contains(PackedMessageID requestID) const {
+        return slots[Probe(requestID.value)].key == requestID.value;
+    }
+
+    /// @brief Checks if a request is pending.
+    bool Contains(const MessageID& requestID) const {
+        return requestID && Contains(requestID.Pack());
+    }
+
+    /**
+     * @brief Routes an inbound message to the handler of the request it responds to.
+     * 
+     * An EndResponse completes the request: it is removed from the table before its handler is called.
+     * 
+     * @param message Any received message
+     * @return True if the message responded to a pending request and was delivered, false otherwise
+     * @throws Whatever the handler throws. The request stays pending unless the message was an EndResponse
+     */
+    bool Dispatch(const Message& message) {
+        if (!message.responseID || !*message.responseID)
+            return false;
+        uint64_t key = message.responseID->Pack().value;
+        size_t i = Probe(key);
+        if (slots[i].key != key)
+            return false;
+
+        // Take the handler out of the table before calling it, so the handler can safely change the table
+        Handler handler = std::move(slots[i].handler);
+        slots[i].handler = nullptr; // A moved-from std::function is not guaranteed to be empty, and Restore relies on it
+        if (dynamic_cast<const EndResponse*>(&message)) {
+            Erase(i);
+            handler(message, true);
+            return true;
         }
 
-        // Extract message index from last 3 digits (### portion of HHMMSSmmm###)
-        messageIndex = static_cast<int>(std::stoi(id.substr(9, 3)));
-
-        // Parse timestamp from first 9 digits (HHMMSSmmm portion)
-        // Extract: HH (hours), MM (minutes), SS (seconds), mmm (milliseconds)
-        std::chrono::milliseconds total_ms = std::chrono::hours(std::stoi(id.substr(0, 2)))      // HH
-                  + std::chrono::minutes(std::stoi(id.substr(2, 2)))    // MM
-                  + std::chrono::seconds(std::stoi(id.substr(4, 2)))    // SS
-                  + std::chrono::milliseconds(std::stoi(id.substr(6, 3))); // mmm
-        
-        // Convert relative time (since midnight) to absolute time_point
-        // The Virgil protocol uses time since midnight of the current day
-        std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-        std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-        std::tm* now_tm = std::localtime(&now_time);
-        
-        // Calculate midnight of today as our reference point
-        std::chrono::system_clock::time_point midnight = std::chrono::system_clock::from_time_t(std::mktime(now_tm));
-        
-        // Final timestamp = midnight + parsed time offset
-        timeSent = midnight + total_ms;
+        struct Restore {
+            PendingRequests& table;
+            uint64_t key;
+            Handler& handler;
+            ~Restore() {
+                // Put the handler back unless the request was removed (or replaced) while it ran
+                size_t slot = table.Probe(key);
+                if (table.slots[slot].key == key && !table.slots[slot].handler)
+                    table.slots[slot].handler = std::move(handler);
+            }
+        } restore{*this, key, handler};
+        handler(message, false);
+        return true;
     }
 
-    /// Convert to string to be used in virgil messages
-    /// @return HHMMSSmmm### format
-    std::string to_string() const {
-        // Calculate ms since midnight for this timeSent
-        std::time_t time_time = std::chrono::system_clock::to_time_t(timeSent);
-        std::tm* time_tm = std::localtime(&time_time);
-        std::chrono::system_clock::time_point midnight = std::chrono::system_clock::from_time_t(std::mktime(time_tm));
-        std::chrono::milliseconds ms_since_midnight = std::chrono::duration_cast<std::chrono::milliseconds>(timeSent - midnight);
-        long long ms = ms_since_midnight.count();
-        int hour = static_cast<int>(ms / 3600000);
-        ms = ms % 3600000;
-        int minute = static_cast<int>(ms / 60000);
-        ms = ms % 60000;
-        int second = static_cast<int>(ms / 1000);
-        ms = ms % 1000;
-        int millisecond = static_cast<int>(ms);
-        std::ostringstream oss;
-        oss << std::setw(2) << std::setfill('0') << hour
-            << std::setw(2) << std::setfill('0') << minute
-            << std::setw(2) << std::setfill('0') << second
-            << std::setw(3) << std::setfill('0') << millisecond
-            << std::setw(3) << std::setfill('0') << messageIndex;
-        return oss.str();
+    /// @brief Gets the number of pending requests.
+    size_t Size() const {
+        return count;
     }
 
-    bool operator==(const MessageID& other) const {
-        return timeSent == other.timeSent && messageIndex == other.messageIndex;
+    /// @brief Checks if no requests are pending.
+    bool Empty() const {
+        return count == 0;
     }
-    bool operator!=(const MessageID& other) const {
-        return !(*this == other);
+
+    /// @brief Removes every pending request without calling the handlers, and releases the table memory.
+    void Clear() {
+        slots.assign(MinCapacity, Slot{});
+        count = 0;
     }
 
-    operator bool() const {
-    // Consider it valid if timeSent is not epoch or messageIndex is not zero
-    return timeSent != std::chrono::system_clock::time_point{} || messageIndex != 0;
+private:
+    // Packed IDs never reach this value (milliseconds since midnight fit in 27 bits)
+    static constexpr uint64_t EmptyKey = ~uint64_t(0);
+    static constexpr size_t MinCapacity = 16;
+
+    struct Slot {
+        uint64_t key = EmptyKey;
+        Handler handler;
+    };
+
+    std::vector<Slot> slots; // Capacity is always a power of two
+    size_t count = 0;
+
+    size_t HomeSlot(uint64_t key) const {
+        return std::hash<PackedMessageID>{}(PackedMessageID(key)) & (slots.size() - 1);
+    }
+
+    // Finds the slot holding key, or the empty slot where it would be inserted.
+    size_t Probe(uint64_t key) const {
+        size_t mask = slots.size() - 1;
+        size_t i = HomeSlot(key);
+        while (slots[i].key != key && slots[i].key != EmptyKey)
+            i = (i + 1) & mask;
+        return i;
+    }
+
+    // Empties slot i, shifting later entries of the same probe run back so no tombstones are needed.
+    void Erase(size_t i) {
+        size_t mask = slots.size() - 1;
+        size_t j = i;
+        while (true) {
+            j = (j + 1) & mask;
+            if (slots[j].key == EmptyKey)
+                break;
+            // Entry j can fill the hole at i only if its home slot is not cyclically within (i, j]
+            size_t home = HomeSlot(slots[j].key);
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                slots[i] = std::move(slots[j]);
+                i = j;
+            }
+        }
+        slots[i].key = EmptyKey;
+        slots[i].handler = nullptr;
+        --count;
     }
 
+    void Rehash(size_t capacity) {
+        std::vector<Slot> old(capacity);
+        old.swap(slots);
+        for (Slot& slot : old) {
+            if (slot.key != EmptyKey) {
+                Slot& target = slots[Probe(slot.key)];
+                target.key = slot.key;
+                target.handler = std::move(slot.handler);
+            }
+        }
+    }
 };
 
 #endif
@@ -1,3 +1,462 @@
+// Round-trip test for VirgilLib.hpp.
+// Build and run with: g++ -std=c++17 -pthread -I. test.cpp -o test && ./test
 
+#include "VirgilLib.hpp"
+#include <iostream>
+#include <set>
+#include <unordered_set>
+#include <thread>
 
-class 
\ No newline at end of file
+static int failures = 0;
+
+static void Expect(bool condition, const char* what, std::string_view text) {
+    if(!condition) {
+        std::cerr << "FAIL: " << what << "\n  " << text << "\n";
+        ++failures;
+    }
+}
+
+// Decodes one message through every decoder and checks that they agree with each other
+// and with the original text, and that to_json() and serialize() produce the same fields.
+static void RoundTrip(std::string_view text) {
+    const nlohmann::json original = nlohmann::json::parse(text);
+
+    std::unique_ptr<Message> fromJSON(Message::FromJSON(original, false));
+    std::unique_ptr<Message> decoded(MessageDecoder::Decode(text, false));
+    MessagePtr pooled = MessageDecoder::DecodePooled(text, false);
+    AnyMessage value = MessageDecoder::DecodeValue(text, false);
+
+    Expect(fromJSON->to_json() == original, "FromJSON to_json matches input", text);
+    Expect(decoded->to_json() == original, "MessageDecoder::Decode to_json matches input", text);
+    Expect(pooled->to_json() == original, "MessageDecoder::DecodePooled to_json matches input", text);
+    Expect(AsMessage(value).to_json() == original, "MessageDecoder::DecodeValue to_json matches input", text);
+    Expect(MessageTypeName(GetMessageType(value)) == original["messageType"].get<std::string>(), "DecodeValue holds the right alternative", text);
+
+    std::string serialized;
+    decoded->append_to(serialized);
+    Expect(nlohmann::json::parse(serialized) == original, "serialize matches to_json", text);
+
+    // Decoding the serialized text again must give back identical text
+    std::unique_ptr<Message> again(MessageDecoder::Decode(serialized, false));
+    std::string reserialized;
+    again->append_to(reserialized);
+    Expect(reserialized == serialized, "serialize is stable across a round trip", text);
+}
+
+// Decoding must not intern names it has not seen before, but decoded names must still compare equal to interned ones.
+static void DecodedNames() {
+    const char* text = R"({"messageType":"infoResponse","messageID":"120000000007","responseID":"120000000005","channelIndex":1,"channelType":0,)"
+        R"("linkedChannels":[],"madeUpByPeer":{"dataType":"bool","value":true,"readOnly":true}})";
+    std::unique_ptr<Message> fromJSON(Message::FromJSON(nlohmann::json::parse(text), false));
+    std::unique_ptr<Message> decoded(MessageDecoder::Decode(text, false));
+    Expect(!ParameterName::Find("madeUpByPeer"), "decoders do not intern unknown parameter names", text);
+
+    // Nor must storing the parameters and rebuilding them
+    ChannelParameters channel(static_cast<InfoResponse&>(*decoded).parameters);
+    Parameter rebuilt = channel.ToParameter(0);
+    Expect(!ParameterName::Find("madeUpByPeer"), "ToParameter does not intern unknown parameter names", text);
+    Expect(!rebuilt.name.IsInterned(), "ToParameter keeps the owned name", text);
+
+    for(Message* message : {fromJSON.get(), decoded.get()}) {
+        InfoResponse& response = static_cast<InfoResponse&>(*message);
+        Expect(!response.parameters[0].name.IsInterned(), "unknown parameter names are owned by the parameter", text);
+        Expect(response.FindParameter("madeUpByPeer") != nullptr, "owned names compare equal to interned names", text);
+    }
+}
+
+// Enum value lists from a peer are shared while in use and freed with the last parameter that uses them.
+static void DecodedEnumTables() {
+    const char* text = R"({"messageType":"infoResponse","messageID":"120000000008","responseID":"120000000005","channelIndex":1,"channelType":0,)"
+        R"("linkedChannels":[],"first":{"dataType":"enum","value":"x","enumValues":["x","y","z"],"readOnly":true},)"
+        R"("second":{"dataType":"enum","value":"y","enumValues":["x","y","z"],"readOnly":true}})";
+    std::weak_ptr<const VirgilEnum::ValueTable> table;
+    {
+        std::unique_ptr<Message> decoded(MessageDecoder::Decode(text, false));
+        const InfoResponse& response = static_cast<const InfoResponse&>(*decoded);
+        table = response.parameters[0].GetEnum().GetTable();
+        Expect(table.lock() == response.parameters[1].GetEnum().GetTable(), "equal enum lists share one table", text);
+    }
+    Expect(table.expired(), "enum lists are freed with the last parameter that uses them", text);
+}
+
+// A string parameter that changes type gives up its string without disturbing the other string parameters.
+static void ChannelParameterTypeChanges() {
+    ParameterList params;
+    params.emplace_back("label", std::string("first"), false);
+    params.emplace_back("subDevice", std::string("second"), true);
+    ChannelParameters channel(params);
+    size_t label = *channel.IndexOf("label");
+    size_t subDevice = *channel.IndexOf(KnownParameter::subDevice);
+
+    channel.Update(Parameter("label", 3, true, "dB", std::nullopt, std::nullopt, std::nullopt));
+    Expect(channel.GetInt(label) == 3 && channel.GetString(subDevice) == "second", "changing a string parameter to int keeps other strings", "label");
+    channel.Update(Parameter("label", std::string("third"), false));
+    Expect(channel.GetString(label) == "third" && channel.GetString(subDevice) == "second", "changing it back to string gets a new string", "label");
+    channel.Update(Parameter("subDevice", true, true));
+    channel.Update(Parameter("subDevice", std::string("fourth"), true));
+    Expect(channel.GetString(label) == "third" && channel.GetString(subDevice) == "fourth", "strings stay paired with their parameters", "subDevice");
+}
+
+// Only infoResponse and parameterCommand carry parameters. Object-valued keys of other types are skipped, even invalid ones.
+static void ParametersOnlyWhereCarried() {
+    const char* text = R"({"extension":{"dataType":"nonsense"},"messageType":"infoRequest","messageID":"120000000009","channelIndex":3,"channelType":1})";
+    VirgilResult<MessagePtr> fromJSON = Message::TryFromJSON(nlohmann::json::parse(text), false);
+    Expect(fromJSON.HasValue(), "FromJSON skips object-valued keys of types without parameters", text);
+    Expect(MessageDecoder::TryDecode(text, false).HasValue(), "MessageDecoder skips object-valued keys before messageType", text);
+    const char* after = R"({"messageType":"infoRequest","messageID":"120000000009","channelIndex":3,"channelType":1,"extension":{"value":[{}]}})";
+    Expect(MessageDecoder::TryDecode(after, false).HasValue(), "MessageDecoder skips object-valued keys after messageType", after);
+
+    // A parameter that came before messageType is still checked once the type turns out to carry parameters
+    const char* invalid = R"({"gain":{"dataType":"int","value":1,"readOnly":true,"enumValues":[[1]]},"messageType":"infoResponse",)"
+        R"("messageID":"120000000010","responseID":"120000000005","channelIndex":1,"channelType":0,"linkedChannels":[]})";
+    VirgilResult<MessagePtr> decoded = MessageDecoder::TryDecode(invalid, false);
+    Expect(!decoded && decoded.Error().code == VirgilErrorCode::wrongType && decoded.Error().field == VirgilKey::enumValues,
+        "MessageDecoder reports errors in parameters before messageType", invalid);
+}
+
+// Wrong types and values that do not fit are errors, never silent conversions.
+static void DecoderErrors() {
+    struct Case {
+        const char* text;
+        VirgilErrorCode code;
+    };
+    const Case cases[] = {
+        {R"({"transmittingDevice":"d","messages":{}})", VirgilErrorCode::wrongType},
+        {R"({"transmittingDevice":{},"messages":[]})", VirgilErrorCode::wrongType},
+    };
+    for(const Case& c : cases) {
+        VirgilResult<VirgilEnvelope> envelope = MessageDecoder::TryDecodeEnvelope(c.text, false);
+        Expect(!envelope && envelope.Error().code == c.code, "envelope decoding fails with the right code", c.text);
+    }
+
+    const char* values[] = {"3000000000", "-3000000000", "18446744073709551615", "1.5"};
+    const VirgilErrorCode codes[] = {VirgilErrorCode::outOfRange, VirgilErrorCode::outOfRange, VirgilErrorCode::outOfRange, VirgilErrorCode::wrongType};
+    for(size_t i = 0; i < std::size(values); ++i) {
+        std::string text = std::string(R"({"messageType":"infoResponse","messageID":"120000000011","responseID":"120000000005","channelIndex":1,)") +
+            R"("channelType":0,"linkedChannels":[],"gain":{"dataType":"int","readOnly":true,"unit":"dB","value":)" + values[i] + "}}";
+        VirgilResult<MessagePtr> decoded = MessageDecoder::TryDecode(text, false);
+        Expect(!decoded && decoded.Error().code == codes[i], "MessageDecoder rejects int values that are not ints", text);
+        VirgilResult<MessagePtr> fromJSON = Message::TryFromJSON(nlohmann::json::parse(text), false);
+        Expect(!fromJSON && fromJSON.Error().code == codes[i], "FromJSON rejects int values that are not ints", text);
+    }
+
+    // Writable ints at the edges of the int range, where value - minValue does not fit in an int
+    struct Writable {
+        const char* fields;
+        bool valid;
+    };
+    const Writable writable[] = {
+        {R"("value":-2147483648,"minValue":2147483647,"maxValue":2147483647,"precision":1)", false},
+        {R"("value":2147483647,"minValue":-2147483648,"maxValue":2147483647,"precision":2)", false},
+        {R"("value":2147483647,"minValue":-2147483648,"maxValue":2147483647,"precision":1)", true},
+    };
+    for(const Writable& w : writable) {
+        std::string text = std::string(R"({"messageType":"infoResponse","messageID":"120000000012","responseID":"120000000005","channelIndex":1,)") +
+            R"("channelType":0,"linkedChannels":[],"gain":{"dataType":"int","readOnly":false,"unit":"dB",)" + w.fields + "}}";
+        VirgilResult<MessagePtr> decoded = MessageDecoder::TryDecode(text, false);
+        Expect(w.valid ? decoded.HasValue() : !decoded && decoded.Error().code == VirgilErrorCode::invalidValue,
+            "MessageDecoder checks the range and step of int values", text);
+        VirgilResult<MessagePtr> fromJSON = Message::TryFromJSON(nlohmann::json::parse(text), false);
+        Expect(w.valid ? fromJSON.HasValue() : !fromJSON && fromJSON.Error().code == VirgilErrorCode::invalidValue,
+            "FromJSON checks the range and step of int values", text);
+    }
+}
+
+// Responses without a responseID cannot be sent.
+static void ResponsesNeedResponseID() {
+    ErrorResponse error(MessageID::GenerateNew(), true, MessageID::GenerateNew(), "Busy", "try again later");
+    error.responseID = std::nullopt;
+    EndResponse end(MessageID::GenerateNew(), true, MessageID::GenerateNew());
+    end.responseID = std::nullopt;
+    for(const Message* message : {static_cast<const Message*>(&error), static_cast<const Message*>(&end)}) {
+        bool threw = false;
+        try { message->to_json(); } catch(const std::invalid_argument&) { threw = true; }
+        Expect(threw, "to_json throws without a responseID", "");
+        threw = false;
+        std::string buffer;
+        try { message->append_to(buffer); } catch(const std::invalid_argument&) { threw = true; }
+        Expect(threw, "serialize throws without a responseID", "");
+    }
+}
+
+// Envelopes come out whole however the stream is split, and oversized ones are rejected whether or not they are complete.
+static void FramedStreams() {
+    const std::string first = R"({"transmittingDevice":"a","messages":[{"messageType":"x","label":"{\"}\\"}]})";
+    const std::string second = R"({"transmittingDevice":"b","messages":[]})";
+    const std::string stream = first + "\r\n" + second;
+    for(size_t split = 0; split <= stream.size(); ++split) {
+        StreamFramer framer;
+        std::vector<std::string> found;
+        std::string_view envelope;
+        framer.Feed(std::string_view(stream).substr(0, split));
+        while(framer.Next(envelope))
+            found.emplace_back(envelope);
+        framer.Feed(std::string_view(stream).substr(split));
+        while(framer.Next(envelope))
+            found.emplace_back(envelope);
+        Expect(found.size() == 2 && found[0] == first && found[1] == second && framer.Buffered() == 0,
+            "split streams give back both envelopes", stream.substr(0, split));
+    }
+
+    // Limit of one byte less than the first envelope
+    auto tooLarge = [&](std::string_view chunk) {
+        StreamFramer framer(first.size() - 1);
+        framer.Feed(chunk);
+        std::string_view envelope;
+        try { framer.Next(envelope); }
+        catch(const VirgilDecodeException& e) { return e.Code() == VirgilErrorCode::tooLarge && framer.Buffered() == 0; }
+        return false;
+    };
+    Expect(tooLarge(stream), "a complete envelope over the limit is rejected", stream);
+    Expect(tooLarge(first.substr(0, first.size() - 1) + " "), "an incomplete envelope over the limit is rejected", first);
+    StreamFramer exact(first.size());
+    std::string_view envelope;
+    exact.Feed(first);
+    Expect(exact.Next(envelope) && envelope == first, "an envelope of exactly the limit is accepted", first);
+
+    bool threw = false;
+    try { exact.Prepare(first.size() + 1); } catch(const std::invalid_argument&) { threw = true; }
+    Expect(threw, "Prepare rejects sizes over the limit", first);
+}
+
+// Responses reach the handler of their request, and the table stays consistent while handlers change it.
+static void PendingRequestTable() {
+    // Find IDs that share the last home slot of a 16-slot table, so their probe run wraps to the front
+    auto homeSlot = [](PackedMessageID id) { return std::hash<PackedMessageID>{}(id) & 15; };
+    std::vector<PackedMessageID> last, first;
+    for(uint16_t index = 0; last.size() < 3 || first.empty(); ++index) {
+        PackedMessageID id(43200000, index);
+        if(homeSlot(id) == 15)
+            last.push_back(id);
+        else if(homeSlot(id) == 0)
+            first.push_back(id);
+    }
+    const PackedMessageID ids[] = {last[0], last[1], first[0], last[2]};
+
+    PendingRequests table(8);
+    std::vector<PackedMessageID> delivered;
+    for(PackedMessageID id : ids)
+        table.Add(id, [&delivered, id](const Message&, bool) { delivered.push_back(id); });
+    for(size_t removed = 0; removed < std::size(ids); ++removed) {
+        Expect(table.Remove(ids[removed]) && !table.Contains(ids[removed]), "Remove finds every entry of a wrapped probe run", "");
+        for(size_t i = removed + 1; i < std::size(ids); ++i) {
+            delivered.clear();
+            ErrorResponse response(MessageID::GenerateNew(), false, MessageID(ids[i]), "Busy", "");
+            Expect(table.Dispatch(response) && delivered.size() == 1 && delivered[0] == ids[i],
+                "entries after an erased one keep their handlers", "");
+        }
+    }
+    Expect(table.Empty(), "the table is empty after removing every entry", "");
+
+    bool threw = false;
+    try { table.Add(ids[0], PendingRequests::Handler()); } catch(const std::invalid_argument&) { threw = true; }
+    Expect(threw && table.Empty(), "Add rejects an empty handler", "");
+
+    // A handler that removes its own request is not put back
+    MessageID request = MessageID::GenerateNew();
+    ErrorResponse error(MessageID::GenerateNew(), false, request, "Busy", "");
+    table.Add(request, [&](const Message&, bool) { table.Remove(request); });
+    Expect(table.Dispatch(error) && !table.Contains(request), "a handler can remove its own request", "");
+
+    // A handler that replaces its own request keeps the replacement
+    int calls = 0;
+    table.Add(request, [&](const Message&, bool) {
+        table.Remove(request);
+        table.Add(request, [&](const Message&, bool) { calls += 10; });
+        ++calls;
+    });
+    table.Dispatch(error);
+    table.Dispatch(error);
+    Expect(calls == 11, "a handler can replace its own request", "");
+
+    // Other responses leave the request pending, EndResponse completes it
+    bool completed = false;
+    table.Remove(request);
+    table.Add(request, [&](const Message&, bool complete) { completed = complete; });
+    table.Dispatch(error);
+    Expect(!completed && table.Contains(request), "responses before EndResponse leave the request pending", "");
+    EndResponse end(MessageID::GenerateNew(), false, request);
+    Expect(table.Dispatch(end) && completed && !table.Contains(request) && !table.Dispatch(end), "EndResponse completes the request", "");
+}
+
+// Envelopes are flushed when they reach either limit, and a message that does not fit starts the next envelope intact.
+static void BatchedEnvelopes() {
+    std::vector<VirgilEnvelope> sent;
+    size_t largest = 0;
+    auto onFlush = [&](std::string_view packet) {
+        largest = std::max(largest, packet.size());
+        sent.push_back(MessageDecoder::DecodeEnvelope(packet, false));
+    };
+    std::vector<MessageID> ids;
+    for(int i = 0; i < 5; ++i)
+        ids.push_back(MessageID::GenerateNew());
+    auto received = [&]() {
+        std::vector<MessageID> order;
+        for(const VirgilEnvelope& envelope : sent)
+            for(const MessagePtr& message : envelope.messages)
+                order.push_back(message->selfID);
+        return order;
+    };
+
+    EnvelopeWriter byCount("stagebox", onFlush, EnvelopeWriter::DefaultMaxBytes, 2);
+    for(const MessageID& id : ids)
+        byCount.Add(EndResponse(id, true, ids[0]));
+    Expect(sent.size() == 2 && byCount.MessageCount() == 1, "envelopes are flushed every maxMessages messages", "");
+    byCount.Flush();
+    Expect(sent.size() == 3 && byCount.MessageCount() == 0 && received() == ids, "Flush sends the remaining messages in order", "");
+    Expect(sent[0].transmittingDevice == "stagebox", "envelopes carry the transmitting device", "");
+
+    // Room for two of these messages and the comma between them, but not three
+    std::string one;
+    EndResponse(ids[0], true, ids[0]).append_to(one);
+    const size_t limit = EnvelopeWriter("stagebox", onFlush).Size() + 2 * one.size() + 2;
+    sent.clear();
+    largest = 0;
+    EnvelopeWriter byBytes("stagebox", onFlush, limit);
+    for(const MessageID& id : ids)
+        byBytes.Add(EndResponse(id, true, ids[0]));
+    byBytes.Flush();
+    Expect(sent.size() == 3 && sent[0].messages.size() == 2 && largest <= limit, "envelopes are flushed before they exceed maxBytes", "");
+    Expect(received() == ids, "messages that spill into the next envelope keep their messageID", "");
+}
+
+// MessageIDs are exactly 12 digits forming a time of day, and parse to the fields they spell out.
+static void ParsedMessageIDs() {
+    const char* invalid[] = {"", "12000000000", "1200000000000", "12000000000a", "1200 0000000", "12000000000/", "12000000000:",
+        "250000000000", "126000000000", "120060000000"};
+    for(const char* text : invalid) {
+        VirgilResult<MessageID> parsed = MessageID::TryParse(text);
+        Expect(!parsed && parsed.Error().code == VirgilErrorCode::invalidMessageID, "TryParse rejects malformed MessageIDs", text);
+        Expect(!MessageID::TryParsePacked(text), "TryParsePacked rejects malformed MessageIDs", text);
+        bool threw = false;
+        try { MessageID id(text); } catch(const VirgilDecodeException&) { threw = true; }
+        Expect(threw, "the string constructor rejects malformed MessageIDs", text);
+    }
+
+    const char* valid[] = {"000000000000", "123456789012", "235959999999"};
+    for(const char* text : valid)
+        Expect(MessageID::TryParse(text).HasValue() && MessageID(text).to_string() == text, "valid MessageIDs format back to the same text", text);
+    PackedMessageID packed = MessageID::ParsePacked("123456789012");
+    Expect(packed.MillisecondsSinceMidnight() == ((12 * 60 + 34) * 60 + 56) * 1000 + 789 && packed.Index() == 12,
+        "ParsePacked decodes every field", "123456789012");
+    Expect(MessageID::TryParsePacked("240000000000").HasValue(), "hour 24 is accepted for days with 25 hours", "240000000000");
+}
+
+// Generates IDs on several threads at once and checks that no ID is handed out twice.
+static void ConcurrentMessageIDs(bool sharded) {
+    constexpr uint16_t threadCount = 4;
+    constexpr size_t perThread = 5000;
+    std::vector<std::vector<MessageID>> generated(threadCount);
+    std::vector<std::thread> threads;
+    for(uint16_t t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&generated, sharded, t]() {
+            if(sharded)
+                MessageID::SetThreadShard(t, threadCount);
+            for(size_t i = 0; i < perThread; ++i)
+                generated[t].push_back(MessageID::GenerateNew());
+            MessageID::ClearThreadShard();
+        });
+    }
+    for(std::thread& thread : threads)
+        thread.join();
+
+    std::set<std::pair<std::chrono::system_clock::time_point, uint16_t>> unique;
+    bool inRange = true;
+    for(const std::vector<MessageID>& ids : generated) {
+        for(const MessageID& id : ids) {
+            unique.emplace(id.timeSent, id.messageIndex);
+            inRange = inRange && id.messageIndex <= MessageID::MaxMessageIndex;
+        }
+    }
+    const char* what = sharded ? "sharded threads" : "shared generator";
+    Expect(unique.size() == threadCount * perThread, "concurrent GenerateNew calls never return the same ID", what);
+    Expect(inRange, "generated indices fit in three digits", what);
+}
+
+// Once the indices of a millisecond run out, IDs continue in the next millisecond, but never too far ahead of the clock.
+static void BorrowedMilliseconds() {
+    // One index per millisecond, so every ID after the first in a millisecond has to borrow
+    MessageID::SetThreadShard(7, 1000);
+    MessageID previous;
+    bool increasing = true;
+    bool bounded = true;
+    for(int i = 0; i < 100; ++i) {
+        MessageID id = MessageID::GenerateNew();
+        std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+        increasing = increasing && id.timeSent > previous.timeSent && id.messageIndex == 7;
+        bounded = bounded && id.timeSent <= now + std::chrono::milliseconds(MessageID::MaxBorrowedMilliseconds);
+        previous = id;
+    }
+    MessageID::ClearThreadShard();
+    Expect(increasing, "a used-up millisecond continues in the next one", "");
+    Expect(bounded, "borrowing stays within MaxBorrowedMilliseconds of the clock", "");
+
+    // The shared generator only moves forward, including past index 999
+    previous = MessageID::GenerateNew();
+    increasing = true;
+    for(int i = 0; i < 5000; ++i) {
+        MessageID id = MessageID::GenerateNew();
+        increasing = increasing && (id.timeSent > previous.timeSent || (id.timeSent == previous.timeSent && id.messageIndex > previous.messageIndex));
+        previous = id;
+    }
+    Expect(increasing, "the shared generator hands out increasing IDs", "");
+}
+
+// Packed IDs hold exactly what the HHMMSSmmm### text holds, and order and hash like the text.
+static void PackedMessageIDs() {
+    MessageID generated = MessageID::GenerateNew();
+    Expect(MessageID(generated.Pack()) == generated, "unpacking a packed ID gives back the ID", generated.to_string());
+    Expect(MessageID::ParsePacked(generated.to_string()) == generated.Pack(), "ParsePacked matches Pack", generated.to_string());
+
+    const char* ascending[] = {"000000000000", "000000000001", "000000000999", "000000001000", "120000000000", "235959999999"};
+    bool ordered = true;
+    for(size_t i = 1; i < std::size(ascending); ++i)
+        ordered = ordered && MessageID::ParsePacked(ascending[i - 1]) < MessageID::ParsePacked(ascending[i]);
+    Expect(ordered, "packed IDs order like their text", "");
+
+    std::unordered_set<PackedMessageID> unique;
+    for(uint16_t index = 0; index <= MessageID::MaxMessageIndex; ++index)
+        unique.insert(PackedMessageID(43200000, index));
+    unique.insert(MessageID::ParsePacked("120000000999"));
+    Expect(unique.size() == 1000u, "equal packed IDs hash equal and distinct ones are kept apart", "");
+}
+
+int main() {
+    const char* messages[] = {
+        R"({"messageType":"channelLink","messageID":"120000000001","sendingChannelIndex":1,"sendingChannelType":0,"channelIndex":2,"channelType":1})",
+        R"({"messageType":"channelUnlink","messageID":"120000000002","sendingChannelIndex":1,"sendingChannelType":2})",
+        R"({"messageType":"endResponse","messageID":"120000000003","responseID":"120000000000"})",
+        R"({"messageType":"errorResponse","messageID":"120000000004","responseID":"120000000000","errorValue":"Busy","errorString":"try again later"})",
+        R"({"messageType":"infoRequest","messageID":"120000000005","channelIndex":3,"channelType":1})",
+        R"({"messageType":"infoResponse","messageID":"120000000006","responseID":"120000000005","channelIndex":1,"channelType":0,)"
+        R"("linkedChannels":[{"deviceName":"stagebox","channelIndex":4,"channelType":1}],)"
+        R"("gain":{"dataType":"int","value":10,"readOnly":false,"unit":"dB","minValue":0,"maxValue":60,"precision":1},)"
+        R"("phantomPower":{"dataType":"bool","value":true,"readOnly":false},)"
+        R"("level":{"dataType":"float","value":-3.5,"readOnly":true,"unit":"dBFS"},)"
+        R"("label":{"dataType":"string","value":"a label longer than the small string buffer","readOnly":true},)"
+        R"("mode":{"dataType":"enum","value":"b","enumValues":["a","b"],"readOnly":false}})"
+    };
+    for(const char* message : messages)
+        RoundTrip(message);
+    DecodedNames();
+    DecodedEnumTables();
+    ChannelParameterTypeChanges();
+    ParametersOnlyWhereCarried();
+    DecoderErrors();
+    ResponsesNeedResponseID();
+    FramedStreams();
+    PendingRequestTable();
+    BatchedEnvelopes();
+    ParsedMessageIDs();
+    ConcurrentMessageIDs(false);
+    ConcurrentMessageIDs(true);
+    BorrowedMilliseconds();
+    PackedMessageIDs();
+
+    if(failures) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All round-trip checks passed\n";
+    return 0;
+}